@@ -0,0 +1,64 @@
+/*  ==========================================================================================
+    Author: Leonardo Citraro
+    Company:
+    Filename: CancellationToken.hpp
+    Last modifed:   17.10.2026 by Leonardo Citraro
+    Description:    Token used to cancel long computations (process(), detection...)
+                    from another thread.
+
+    ==========================================================================================
+    Copyright (c) 2016 Leonardo Citraro <ldo.citraro@gmail.com>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this
+    software and associated documentation files (the "Software"), to deal in the Software
+    without restriction, including without limitation the rights to use, copy, modify,
+    merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+    permit persons to whom the Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be included in all copies
+    or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+    INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+    PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+    FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+    OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+    ==========================================================================================
+*/
+#ifndef CANCELLATIONTOKEN_HPP
+#define CANCELLATIONTOKEN_HPP
+
+#include <memory>
+#include <atomic>
+#include <functional>
+#include <stdexcept>
+#include <string>
+
+/// Cooperative cancellation: the copies of a token share the same state, one
+/// thread calls cancel() and the computation checks is_cancelled() regularly.
+class CancellationToken {
+private:
+    std::shared_ptr<std::atomic<bool>> _cancelled;
+
+public:
+    CancellationToken() : _cancelled(std::make_shared<std::atomic<bool>>(false)) {}
+    
+    /// Requests the cancellation of the computations using this token
+    void cancel() const { *_cancelled = true; }
+    
+    /// @return true if the cancellation has been requested
+    bool is_cancelled() const { return *_cancelled; }
+};
+
+/// Thrown by a computation that stops because its token has been cancelled
+class OperationCancelled : public std::runtime_error {
+public:
+    OperationCancelled(const std::string& what) : std::runtime_error(what) {}
+};
+
+/// Callback receiving the progress of a long computation, between 0 and 1
+using ProgressCallback = std::function<void(const float progress)>;
+
+#endif
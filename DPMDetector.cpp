@@ -0,0 +1,259 @@
+/*  ==========================================================================================
+    Author: Leonardo Citraro
+    Company:
+    Filename: DPMDetector.cpp
+    Last modifed:   17.10.2026 by Leonardo Citraro
+    Description:    Deformable part model (Felzenszwalb et al.) scored on a pyramid
+                    of HOG cell maps. The parts are placed with the linear-time
+                    generalized distance transform.
+
+    ==========================================================================================
+    Copyright (c) 2016 Leonardo Citraro <ldo.citraro@gmail.com>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this
+    software and associated documentation files (the "Software"), to deal in the Software
+    without restriction, including without limitation the rights to use, copy, modify,
+    merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+    permit persons to whom the Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be included in all copies
+    or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+    INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+    PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+    FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+    OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+    ==========================================================================================
+*/
+#include "DPMDetector.hpp"
+#include "opencv2/imgproc/imgproc.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <mutex>
+#include <vector>
+
+// 1D distance transform: out[p] = max_q f[q] - a*(q-p)^2 - b*(q-p).
+// With g = -f this is the lower envelope of the parabolas g[q] + a*(p-c_q)^2 
+// centered in c_q = q + b/(2a), all with the same shape, so the envelope is
+// built in one pass and read in another one (Felzenszwalb and Huttenlocher).
+// The buffers v (parabolas of the envelope) and z (boundaries) are reused.
+static void distance_transform_1d(const float* f, const int step, const int n, const float a, const float b,
+                                  float* out, int* best, const int out_step,
+                                  std::vector<int>& v, std::vector<float>& z) {
+    const float shift = b/(2*a);
+    v.resize(n);
+    z.resize(n+1);
+    auto g = [&](const int q) { return -f[q*step]; };
+    int k = 0;
+    v[0] = 0;
+    z[0] = -std::numeric_limits<float>::infinity();
+    z[1] = std::numeric_limits<float>::infinity();
+    for(int q = 1; q < n; ++q) {
+        // intersection with the last parabola of the envelope (the centers are q+shift and v[k]+shift),
+        // the parabolas hidden by the one of q are removed (z[0] = -inf stops the loop)
+        auto intersection = [&](const int r) {
+            return ((g(q) + a*(q+shift)*(q+shift)) - (g(r) + a*(r+shift)*(r+shift))) / (2*a*(q-r));
+        };
+        float s = intersection(v[k]);
+        while(s <= z[k]) {
+            --k;
+            s = intersection(v[k]);
+        }
+        ++k;
+        v[k] = q;
+        z[k] = s;
+        z[k+1] = std::numeric_limits<float>::infinity();
+    }
+    k = 0;
+    for(int p = 0; p < n; ++p) {
+        while(z[k+1] < p)
+            ++k;
+        const int q = v[k];
+        const float d = q - p;
+        out[p*out_step] = f[q*step] - a*d*d - b*d;
+        best[p*out_step] = q;
+    }
+}
+
+DPMDetector::DPMDetector(const HOG& hog, const DPMModel& model, const size_t interval, const float threshold)
+    : _hog(hog), _model(model), _interval(interval), _threshold(threshold),
+      _features([](HOG& hog, const cv::Mat& img) { hog.process(img); return hog.get_cell_map(); }) {
+        if(interval < 1)
+            throw std::runtime_error("DPMDetector::DPMDetector(): interval must be at least 1!");
+        if(model.root.empty())
+            throw std::runtime_error("DPMDetector::DPMDetector(): the model has no root filter!");
+        for(const auto& part : model.parts) {
+            if(part.filter.size() != model.root.size())
+                throw std::runtime_error("DPMDetector::DPMDetector(): the parts and the root have a different number of channels!");
+            if(part.deformation[1] <= 0 || part.deformation[3] <= 0)
+                throw std::runtime_error("DPMDetector::DPMDetector(): the quadratic deformation costs must be positive!");
+        }
+        // the parts are placed without lazy retrieval, all the cells are needed
+        _hog.set_lazy(false);
+    }
+DPMDetector::~DPMDetector() {}
+
+void DPMDetector::set_features(const Features& features) {
+    _features = features;
+}
+
+void DPMDetector::set_executor(const std::shared_ptr<Executor>& executor) {
+    _executor = executor;
+}
+
+cv::Mat DPMDetector::filter_response(const std::vector<cv::Mat>& features, const std::vector<cv::Mat>& filter) {
+    if(features.size() != filter.size())
+        throw std::runtime_error("DPMDetector::filter_response(): the features and the filter have a different number of channels!");
+    const cv::Size size = features[0].size();
+    const cv::Size filter_size = filter[0].size();
+    if(size.height < filter_size.height || size.width < filter_size.width)
+        return cv::Mat();
+    
+    // cv::filter2D() correlates (it doesn't flip the kernel) and is vectorized,
+    // with the anchor on the top-left corner the valid positions are on the top-left
+    const cv::Rect valid(0, 0, size.width - filter_size.width + 1, size.height - filter_size.height + 1);
+    cv::Mat response = cv::Mat::zeros(valid.height, valid.width, CV_32F);
+    cv::Mat channel_response;
+    for(size_t c = 0; c < features.size(); ++c) {
+        cv::filter2D(features[c], channel_response, CV_32F, filter[c], cv::Point(0, 0), 0, cv::BORDER_CONSTANT);
+        response += channel_response(valid);
+    }
+    return response;
+}
+
+void DPMDetector::distance_transform(const cv::Mat& response, const cv::Vec4f& deformation, 
+                                     cv::Mat& out, cv::Mat& best_x, cv::Mat& best_y) {
+    if(deformation[1] <= 0 || deformation[3] <= 0)
+        throw std::runtime_error("DPMDetector::distance_transform(): the quadratic deformation costs must be positive!");
+    
+    const int rows = response.rows;
+    const int cols = response.cols;
+    cv::Mat tmp(rows, cols, CV_32F);
+    cv::Mat tmp_x(rows, cols, CV_32S);
+    out.create(rows, cols, CV_32F);
+    best_x.create(rows, cols, CV_32S);
+    best_y.create(rows, cols, CV_32S);
+    std::vector<int> v;
+    std::vector<float> z;
+    
+    // along x, then along y on the result
+    for(int i = 0; i < rows; ++i)
+        distance_transform_1d(response.ptr<float>(i), 1, cols, deformation[1], deformation[0], 
+                              tmp.ptr<float>(i), tmp_x.ptr<int>(i), 1, v, z);
+    const int step = static_cast<int>(tmp.step1());
+    const int out_step = static_cast<int>(out.step1());
+    for(int j = 0; j < cols; ++j)
+        distance_transform_1d(tmp.ptr<float>(0) + j, step, rows, deformation[3], deformation[2], 
+                              out.ptr<float>(0) + j, best_y.ptr<int>(0) + j, out_step, v, z);
+    for(int i = 0; i < rows; ++i) {
+        for(int j = 0; j < cols; ++j)
+            best_x.at<int>(i, j) = tmp_x.at<int>(best_y.at<int>(i, j), j);
+    }
+}
+
+std::vector<DPMDetection> DPMDetector::detect(const cv::Mat& img) {
+    if(!img.data)
+        throw std::runtime_error("DPMDetector::detect(): invalid image!");
+    
+    // the pyramid starts with the image upsampled twice so that the parts of the
+    // first octave of roots (levels >= _interval) have twice their resolution
+    const int cellsize = _hog.get_cellsize();
+    const cv::Size root_size = _model.root[0].size();
+    std::vector<double> factors;
+    for(size_t i = 0; ; ++i) {
+        const double f = 2*std::pow(2.0, -static_cast<double>(i)/_interval);
+        if(img.rows*f < root_size.height*cellsize || img.cols*f < root_size.width*cellsize)
+            break;
+        factors.push_back(f);
+    }
+    
+    Executor& exec = _executor ? *_executor : *Executor::default_executor();
+    std::vector<std::vector<cv::Mat>> features(factors.size());
+    exec.parallel_for(0, factors.size(), 1, [&](const size_t begin, const size_t end) {
+        HOG hog(_hog);
+        for(size_t i = begin; i < end; ++i) {
+            cv::Mat level_img;
+            cv::resize(img, level_img, cv::Size(static_cast<int>(img.cols*factors[i]), static_cast<int>(img.rows*factors[i])), 
+                       0, 0, factors[i] > 1 ? cv::INTER_LINEAR : cv::INTER_AREA);
+            features[i] = _features(hog, level_img);
+            if(features[i].size() != _model.root.size())
+                throw std::runtime_error("DPMDetector::detect(): the features and the model have a different number of channels!");
+        }
+    });
+    
+    std::vector<DPMDetection> detections;
+    if(factors.size() <= _interval)
+        return detections;
+    
+    std::mutex mutex;
+    exec.parallel_for(_interval, factors.size(), 1, [&](const size_t begin, const size_t end) {
+        std::vector<DPMDetection> found;
+        for(size_t level = begin; level < end; ++level) {
+            cv::Mat score = filter_response(features[level], _model.root);
+            if(score.empty())
+                continue;
+            score += _model.bias;
+            
+            // best placement of each part around its anchor, for all the root positions
+            const std::vector<cv::Mat>& part_features = features[level - _interval];
+            std::vector<cv::Mat> part_x(_model.parts.size()), part_y(_model.parts.size());
+            cv::Mat valid = cv::Mat::ones(score.size(), CV_8U);
+            for(size_t p = 0; p < _model.parts.size(); ++p) {
+                const DPMPart& part = _model.parts[p];
+                cv::Mat part_score;
+                cv::Mat response = filter_response(part_features, part.filter);
+                if(response.empty()) {
+                    valid.setTo(0);
+                    break;
+                }
+                distance_transform(response, part.deformation, part_score, part_x[p], part_y[p]);
+                for(int y = 0; y < score.rows; ++y) {
+                    for(int x = 0; x < score.cols; ++x) {
+                        const int ay = 2*y + part.anchor.y;
+                        const int ax = 2*x + part.anchor.x;
+                        if(ay < 0 || ax < 0 || ay >= part_score.rows || ax >= part_score.cols)
+                            valid.at<uchar>(y, x) = 0;
+                        else
+                            score.at<float>(y, x) += part_score.at<float>(ay, ax);
+                    }
+                }
+            }
+            
+            const double scale = 1/factors[level];
+            const double part_scale = 1/factors[level - _interval];
+            for(int y = 0; y < score.rows; ++y) {
+                for(int x = 0; x < score.cols; ++x) {
+                    if(!valid.at<uchar>(y, x) || score.at<float>(y, x) <= _threshold)
+                        continue;
+                    DPMDetection d;
+                    d.rect = cv::Rect(static_cast<int>(x*cellsize*scale), static_cast<int>(y*cellsize*scale),
+                                      static_cast<int>(root_size.width*cellsize*scale), static_cast<int>(root_size.height*cellsize*scale));
+                    d.score = score.at<float>(y, x);
+                    d.scale = scale;
+                    for(size_t p = 0; p < _model.parts.size(); ++p) {
+                        const cv::Size part_size = _model.parts[p].filter[0].size();
+                        const int ay = 2*y + _model.parts[p].anchor.y;
+                        const int ax = 2*x + _model.parts[p].anchor.x;
+                        const int py = part_y[p].at<int>(ay, ax);
+                        const int px = part_x[p].at<int>(ay, ax);
+                        d.parts.push_back(cv::Rect(static_cast<int>(px*cellsize*part_scale), static_cast<int>(py*cellsize*part_scale),
+                                                   static_cast<int>(part_size.width*cellsize*part_scale), 
+                                                   static_cast<int>(part_size.height*cellsize*part_scale)));
+                    }
+                    found.push_back(d);
+                }
+            }
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        detections.insert(std::end(detections), std::begin(found), std::end(found));
+    });
+    
+    std::sort(std::begin(detections), std::end(detections), [](const DPMDetection& a, const DPMDetection& b) {
+        return a.score > b.score;
+    });
+    return detections;
+}
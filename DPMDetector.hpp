@@ -0,0 +1,124 @@
+/*  ==========================================================================================
+    Author: Leonardo Citraro
+    Company:
+    Filename: DPMDetector.hpp
+    Last modifed:   17.10.2026 by Leonardo Citraro
+    Description:    Deformable part model (Felzenszwalb et al.) scored on a pyramid
+                    of HOG cell maps. The parts are placed with the linear-time
+                    generalized distance transform.
+
+    ==========================================================================================
+    Copyright (c) 2016 Leonardo Citraro <ldo.citraro@gmail.com>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this
+    software and associated documentation files (the "Software"), to deal in the Software
+    without restriction, including without limitation the rights to use, copy, modify,
+    merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+    permit persons to whom the Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be included in all copies
+    or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+    INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+    PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+    FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+    OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+    ==========================================================================================
+*/
+#ifndef DPMDETECTOR_HPP
+#define DPMDETECTOR_HPP
+
+#include "HOG.hpp"
+#include "HOGDetector.hpp"
+#include "opencv2/imgproc/imgproc.hpp"
+#include <functional>
+#include <memory>
+#include <vector>
+
+/// A part of a deformable model
+struct DPMPart {
+    std::vector<cv::Mat> filter;    ///< one CV_32F plane per channel, at twice the resolution of the root
+    cv::Point anchor;               ///< ideal position of the part in cells of the part level, relative to the root
+    cv::Vec4f deformation;          ///< cost of a displacement (dx,dy): d[0]*dx + d[1]*dx^2 + d[2]*dy + d[3]*dy^2 (d[1],d[3] > 0)
+};
+
+/// A deformable model: a root filter and parts
+struct DPMModel {
+    std::vector<cv::Mat> root;      ///< one CV_32F plane per channel
+    std::vector<DPMPart> parts;
+    float bias = 0;
+};
+
+/// A detection of a deformable model
+struct DPMDetection : public Detection {
+    std::vector<cv::Rect> parts;    ///< placement of the parts in pixels of the source image
+};
+
+/// Scores a deformable model on a pyramid of HOG features. The root filter is 
+/// applied at every level and each part at the level with twice the resolution,
+/// where its best placement is found for all the root positions at once by the
+/// generalized distance transform (linear in the number of cells).
+class DPMDetector {
+public:
+    /// Computes the features of a level of the pyramid (HOG::get_cell_map() by default)
+    using Features = std::function<std::vector<cv::Mat>(HOG& hog, const cv::Mat& img)>;
+
+private:
+    HOG _hog;
+    DPMModel _model;
+    size_t _interval;       ///< number of levels per octave of the pyramid
+    float _threshold;       ///< minimum score of a detection
+    Features _features;
+    std::shared_ptr<Executor> _executor; ///< runs the levels in parallel (Executor::default_executor() if null)
+
+public:
+    /// @param hog: HOG object holding the configuration
+    /// @param model: the deformable model
+    /// @param interval: number of levels per octave of the pyramid
+    /// @param threshold: minimum score of a detection
+    DPMDetector(const HOG& hog, const DPMModel& model, const size_t interval = 5, const float threshold = 0);
+    ~DPMDetector();
+
+    /// Sets the function computing the features of a level of the pyramid
+    ///
+    /// @param features: the function (must return as many channels as the filters)
+    /// @return none
+    void set_features(const Features& features);
+
+    /// Sets the executor running the levels of the pyramid in parallel
+    ///
+    /// @param executor: the executor (null for the default one)
+    /// @return none
+    void set_executor(const std::shared_ptr<Executor>& executor);
+
+    /// Detects the model in an image
+    ///
+    /// @param img: source image (any size)
+    /// @return the root positions whose score is above the threshold, best first
+    std::vector<DPMDetection> detect(const cv::Mat& img);
+
+    /// Response of a filter at every position where it lies entirely inside the features
+    ///
+    /// @param features: one CV_32F plane per channel
+    /// @param filter: one CV_32F plane per channel
+    /// @return the response, CV_32F of size (features - filter + 1)
+    static cv::Mat filter_response(const std::vector<cv::Mat>& features, const std::vector<cv::Mat>& filter);
+
+    /// Generalized distance transform of a response: 
+    ///     out(y,x) = max_{y',x'} response(y',x') - deformation·(dx, dx^2, dy, dy^2)
+    /// with dx = x'-x and dy = y'-y, in linear time (Felzenszwalb and Huttenlocher).
+    ///
+    /// @param response: CV_32F response of a part
+    /// @param deformation: cost of the displacements (the quadratic terms must be positive)
+    /// @param out: CV_32F transformed response
+    /// @param best_x: CV_32S column of the best placement
+    /// @param best_y: CV_32S row of the best placement
+    /// @return none
+    static void distance_transform(const cv::Mat& response, const cv::Vec4f& deformation, 
+                                   cv::Mat& out, cv::Mat& best_x, cv::Mat& best_y);
+};
+
+#endif
@@ -0,0 +1,223 @@
+/*  ==========================================================================================
+    Author: Leonardo Citraro
+    Company:
+    Filename: Executor.cpp
+    Last modifed:   17.10.2026 by Leonardo Citraro
+    Description:    Executors used by the library to run work in parallel.
+
+    ==========================================================================================
+    Copyright (c) 2016 Leonardo Citraro <ldo.citraro@gmail.com>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this
+    software and associated documentation files (the "Software"), to deal in the Software
+    without restriction, including without limitation the rights to use, copy, modify,
+    merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+    permit persons to whom the Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be included in all copies
+    or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+    INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+    PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+    FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+    OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+    ==========================================================================================
+*/
+#include "Executor.hpp"
+#include <algorithm>
+#include <exception>
+#include <stdexcept>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+std::shared_ptr<Executor> Executor::default_executor() {
+    static std::shared_ptr<Executor> executor = std::make_shared<WorkStealingPool>();
+    return executor;
+}
+
+void SerialExecutor::parallel_for(const size_t begin, const size_t end, const size_t /*grain*/, const Body& body) {
+    if(end > begin)
+        body(begin, end);
+}
+
+size_t SerialExecutor::concurrency() const {
+    return 1;
+}
+
+CallbackExecutor::CallbackExecutor(const Callback& callback, const size_t concurrency) 
+    : _callback(callback), _concurrency(std::max<size_t>(concurrency, 1)) {
+        if(!callback)
+            throw std::runtime_error("CallbackExecutor::CallbackExecutor(): invalid callback!");
+    }
+
+void CallbackExecutor::parallel_for(const size_t begin, const size_t end, const size_t grain, const Body& body) {
+    if(end > begin)
+        _callback(begin, end, std::max<size_t>(grain, 1), body);
+}
+
+size_t CallbackExecutor::concurrency() const {
+    return _concurrency;
+}
+
+// pool and queue of the current thread, set for the worker threads only
+static thread_local const WorkStealingPool* tls_pool = nullptr;
+static thread_local size_t tls_index = 0;
+
+// true if the calling thread already runs in a parallel region other than the
+// pool: an OpenMP parallel region or a worker of another pool
+static bool in_outer_parallel_region(const WorkStealingPool* pool) {
+#ifdef _OPENMP
+    if(omp_in_parallel())
+        return true;
+#endif
+    return tls_pool != nullptr && tls_pool != pool;
+}
+
+WorkStealingPool::WorkStealingPool(const size_t n_threads) : _n_pending(0) {
+    // the calling thread works too, so one thread less is spawned
+    const size_t n_workers = std::max<size_t>(n_threads, 1) - 1;
+    for(size_t i = 0; i < n_workers + 1; ++i)
+        _queues.emplace_back(new Queue());
+    for(size_t i = 0; i < n_workers; ++i)
+        _threads.emplace_back(&WorkStealingPool::work, this, i);
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _cv.notify_all();
+    for(auto& t : _threads)
+        t.join();
+}
+
+void WorkStealingPool::parallel_for(const size_t begin, const size_t end, const size_t grain, const Body& body) {
+    if(end <= begin)
+        return;
+    const size_t step = std::max<size_t>(grain, 1);
+    // inside an outer parallel region the cores are already busy, the loop
+    // runs on the calling thread instead of oversubscribing them
+    if(_threads.empty() || end - begin <= step || in_outer_parallel_region(this)) {
+        body(begin, end);
+        return;
+    }
+    
+    // the tasks only reference the group, it lives until all of them are done
+    struct Group {
+        std::atomic<size_t> remaining;
+        std::mutex mutex;
+        std::exception_ptr error;
+    } group;
+    
+    auto run = [&group, &body](const size_t b, const size_t e) {
+        try {
+            body(b, e);
+        } catch(...) {
+            std::lock_guard<std::mutex> lock(group.mutex);
+            if(!group.error)
+                group.error = std::current_exception();
+        }
+    };
+    
+    const size_t n_chunks = (end - begin + step - 1)/step;
+    group.remaining = n_chunks - 1;
+    // the chunks are pushed in order: the thieves take the front of the queue, so 
+    // the first chunks (e.g. the largest tasks of a sorted batch) are spread over
+    // the threads while the calling thread works from the back
+    for(size_t c = 1; c < n_chunks; ++c) {
+        const size_t b = begin + c*step;
+        const size_t e = std::min(b + step, end);
+        push([this, &group, run, b, e]() {
+            run(b, e);
+            if(--group.remaining == 0) {
+                // wakes the thread waiting for the loop, the lock avoids a lost wake-up
+                { std::lock_guard<std::mutex> lock(_mutex); }
+                _cv.notify_all();
+            }
+        });
+    }
+    
+    // the first chunk is run by the calling thread, then it helps with the 
+    // pending tasks until the whole loop is done
+    run(begin, begin + step);
+    const size_t index = queue_index();
+    while(group.remaining > 0) {
+        if(run_one(index))
+            continue;
+        // nothing to run: sleeps until a task is pushed or the loop is done
+        std::unique_lock<std::mutex> lock(_mutex);
+        _cv.wait(lock, [&]{ return group.remaining == 0 || _n_pending > 0; });
+    }
+    
+    if(group.error)
+        std::rethrow_exception(group.error);
+}
+
+size_t WorkStealingPool::concurrency() const {
+    return _threads.size() + 1;
+}
+
+size_t WorkStealingPool::queue_index() const {
+    return tls_pool == this ? tls_index : _threads.size();
+}
+
+void WorkStealingPool::push(Task task) {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _n_pending++;
+    }
+    {
+        Queue& queue = *_queues[queue_index()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(std::move(task));
+    }
+    _cv.notify_one();
+}
+
+bool WorkStealingPool::run_one(const size_t index) {
+    Task task;
+    
+    // own queue first (most recent task, its data is likely in cache)
+    {
+        Queue& queue = *_queues[index];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if(!queue.tasks.empty()) {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+        }
+    }
+    
+    // then steals the oldest task of the other queues
+    for(size_t i = 1; !task && i < _queues.size(); ++i) {
+        Queue& queue = *_queues[(index + i) % _queues.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if(!queue.tasks.empty()) {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+    }
+    
+    if(!task)
+        return false;
+    _n_pending--;
+    task();
+    return true;
+}
+
+void WorkStealingPool::work(const size_t index) {
+    tls_pool = this;
+    tls_index = index;
+    while(true) {
+        if(run_one(index))
+            continue;
+        std::unique_lock<std::mutex> lock(_mutex);
+        _cv.wait(lock, [this]{ return _stop || _n_pending > 0; });
+        if(_stop && _n_pending == 0)
+            return;
+    }
+}
@@ -0,0 +1,150 @@
+/*  ==========================================================================================
+    Author: Leonardo Citraro
+    Company:
+    Filename: Executor.hpp
+    Last modifed:   17.10.2026 by Leonardo Citraro
+    Description:    Executors used by the library to run work in parallel.
+                    The application can inject its own (thread pool, TBB arena...)
+                    so that the library doesn't oversubscribe the cores.
+
+    ==========================================================================================
+    Copyright (c) 2016 Leonardo Citraro <ldo.citraro@gmail.com>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this
+    software and associated documentation files (the "Software"), to deal in the Software
+    without restriction, including without limitation the rights to use, copy, modify,
+    merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+    permit persons to whom the Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be included in all copies
+    or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+    INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+    PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+    FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+    OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+    ==========================================================================================
+*/
+#ifndef EXECUTOR_HPP
+#define EXECUTOR_HPP
+
+#include <memory>
+#include <vector>
+#include <deque>
+#include <functional>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+/// Interface of the executors: runs a loop in parallel
+class Executor {
+public:
+    using Body = std::function<void(const size_t begin, const size_t end)>;
+    
+    virtual ~Executor() {}
+    
+    /// Runs body over the range [begin,end) split in chunks of at most grain 
+    /// elements and returns when all the chunks are done. It can be called from 
+    /// inside a body (nested parallelism). If a body throws, the exception is 
+    /// rethrown to the caller once the other chunks are done.
+    ///
+    /// @param begin: first element of the range
+    /// @param end: one past the last element of the range
+    /// @param grain: maximum number of elements processed by one call of body
+    /// @param body: function processing the sub-range [begin,end)
+    /// @return none
+    virtual void parallel_for(const size_t begin, const size_t end, const size_t grain, const Body& body) = 0;
+    
+    /// Number of threads that can run the chunks concurrently
+    ///
+    /// @return the number of threads
+    virtual size_t concurrency() const = 0;
+    
+    /// Executor used when none is given: a work-stealing pool shared 
+    /// by the whole process, with one thread per core
+    ///
+    /// @return the default executor
+    static std::shared_ptr<Executor> default_executor();
+};
+
+/// Runs everything on the calling thread
+class SerialExecutor : public Executor {
+public:
+    void parallel_for(const size_t begin, const size_t end, const size_t grain, const Body& body) override;
+    size_t concurrency() const override;
+};
+
+/// Forwards the loops to a parallel_for provided by the application, for 
+/// example a TBB parallel_for or the parallel loop of its own thread pool
+class CallbackExecutor : public Executor {
+public:
+    using Callback = std::function<void(const size_t begin, const size_t end, const size_t grain, const Body& body)>;
+    
+private:
+    Callback _callback;
+    size_t _concurrency;
+    
+public:
+    /// @param callback: parallel_for of the application
+    /// @param concurrency: number of threads used by the callback
+    CallbackExecutor(const Callback& callback, const size_t concurrency);
+    void parallel_for(const size_t begin, const size_t end, const size_t grain, const Body& body) override;
+    size_t concurrency() const override;
+};
+
+/// Work-stealing thread pool. Each worker has its own queue of tasks, it 
+/// takes from the back of its queue and steals from the front of the others
+/// when it runs out of work. The thread calling parallel_for() works too 
+/// while waiting, so nested loops run on the same threads instead of 
+/// spawning new ones; it sleeps when there is nothing to steal. A loop 
+/// called from an outer parallel region (an OpenMP parallel region or a
+/// worker of another pool) runs serially on the calling thread, so an 
+/// application parallelizing over images does not get cores² threads.
+class WorkStealingPool : public Executor {
+private:
+    using Task = std::function<void()>;
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+    
+    std::vector<std::unique_ptr<Queue>> _queues; ///< one queue per worker plus one for the external threads
+    std::vector<std::thread> _threads;
+    std::mutex _mutex; ///< protects the sleep of the workers
+    std::condition_variable _cv;
+    std::atomic<size_t> _n_pending; ///< number of tasks in the queues
+    bool _stop = false;
+    
+public:
+    /// @param n_threads: number of threads working, the thread calling parallel_for() included
+    WorkStealingPool(const size_t n_threads = std::thread::hardware_concurrency());
+    ~WorkStealingPool();
+    
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+    
+    void parallel_for(const size_t begin, const size_t end, const size_t grain, const Body& body) override;
+    size_t concurrency() const override;
+    
+private:
+    /// Index of the queue of the calling thread (the external queue for non-worker threads)
+    size_t queue_index() const;
+    
+    /// Pushes a task in the queue of the calling thread
+    void push(Task task);
+    
+    /// Runs one pending task, from the given queue first then stealing from the others
+    ///
+    /// @param index: queue of the calling thread
+    /// @return false if there was no task to run
+    bool run_one(const size_t index);
+    
+    /// Loop of the worker threads
+    void work(const size_t index);
+};
+
+#endif
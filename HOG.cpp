@@ -29,6 +29,7 @@
     ==========================================================================================
 */
 #include "HOG.hpp"
+#include "HOGKernels.hpp"
 #include "opencv2/imgproc/imgproc.hpp"
 #include "opencv2/highgui/highgui.hpp"
 #include <iostream>
@@ -40,15 +41,30 @@
 #include <math.h>
 #include <iomanip>
 #include <fstream>
+#include <limits>
+#include <cstdint>
+
+// maximum number of cell-rows processed by one parallel task: it bounds
+// the time between two checks of the cancellation token
+static const size_t max_band_rows = 32;
+
+// Morton code (Z-order) of a position: the bits of y and x interleaved, so that
+// positions close in 2D are mostly close in the order
+static uint64_t morton_code(const uint32_t y, const uint32_t x) {
+    uint64_t code = 0;
+    for(size_t b = 0; b < 32; ++b)
+        code |= (static_cast<uint64_t>((x >> b) & 1) << (2*b)) | (static_cast<uint64_t>((y >> b) & 1) << (2*b+1));
+    return code;
+}
 
 // see: https://en.wikipedia.org/wiki/Histogram_of_oriented_gradients#Block_normalization
+// The loops run on the kernels of the instruction set of the CPU (see HOGKernels.hpp)
 void HOG::L1norm(HOG::THist& v) {
-    HOG::TType den = std::accumulate(std::begin(v), std::end(v), 0.0f) + epsilon;
+    const HOGKernels& kernels = hog_kernels();
+    HOG::TType den = kernels.sum(v.data(), v.size()) + epsilon;
 
     if (den != 0)
-        std::transform(std::begin(v), std::end(v), std::begin(v), [den](const HOG::TType nom) {
-        return nom / den;
-    });
+        kernels.scale(v.data(), v.data(), v.size(), 1 / den);
 }
 
 void HOG::L1sqrt(HOG::THist& v) {
@@ -59,27 +75,17 @@ void HOG::L1sqrt(HOG::THist& v) {
 }
 
 void HOG::L2norm(HOG::THist& v) {
-    HOG::THist temp = v;
-    std::transform(std::begin(v), std::end(v), std::begin(temp), [](const HOG::TType & x) {
-        return x * x;
-    });
-    HOG::TType den = std::accumulate(std::begin(temp), std::end(temp), 0.0f);
+    const HOGKernels& kernels = hog_kernels();
+    HOG::TType den = kernels.sum_of_squares(v.data(), v.size());
     den = std::sqrt(den + epsilon);
 
     if (den != 0)
-        std::transform(std::begin(v), std::end(v), std::begin(v), [den](const HOG::TType nom) {
-        return nom / den;
-    });
+        kernels.scale(v.data(), v.data(), v.size(), 1 / den);
 }
 
 void HOG::L2hys(HOG::THist& v) {
     HOG::L2norm(v);
-    auto clip = [](const HOG::TType & x) {
-        if (x > 0.2) return 0.2f;
-        else if (x < 0) return 0.0f;
-        else return x;
-    };
-    std::transform(std::begin(v), std::end(v), std::begin(v), clip);
+    hog_kernels().clip(v.data(), v.size(), 0.0f, 0.2f);
     HOG::L2norm(v);
 }
 
@@ -154,7 +160,8 @@ HOG::~HOG() {}
 HOG::HOG(const HOG& to_copy) 
     : _blocksize(to_copy._blocksize), _cellsize(to_copy._cellsize), _stride(to_copy._stride), _binning(to_copy._binning),
       _grad_type(to_copy._grad_type), _bin_width(_grad_type / _binning), _block_norm(to_copy._block_norm),
-      _norm_function(to_copy._norm_function) {
+      _norm_function(to_copy._norm_function), _lazy(to_copy._lazy), _energy_map(to_copy._energy_map),
+      _rotation_normalization(to_copy._rotation_normalization), _executor(to_copy._executor) {
     }
     
 // assignment operator
@@ -172,10 +179,18 @@ HOG& HOG::operator=(const HOG& to_copy) {
     _n_cells_per_block = _n_cells_per_block_y*_n_cells_per_block_x;
     _block_hist_size = _binning*_n_cells_per_block;
     _stride_unit = _stride/_cellsize;
+    _lazy = to_copy._lazy;
+    _energy_map = to_copy._energy_map;
+    _rotation_normalization = to_copy._rotation_normalization;
+    _executor = to_copy._executor;
     return *this;
 }
 
 void HOG::process(const cv::Mat& img) {
+    process(img, CancellationToken());
+}
+
+void HOG::process(const cv::Mat& img, const CancellationToken& token, const ProgressCallback& progress) {
     
     if(!img.data)
         throw std::runtime_error("HOG::process(): invalid image!");
@@ -184,36 +199,314 @@ void HOG::process(const cv::Mat& img) {
     
     // cleanup
     clear_internals();
+    
+    if(_lazy) {
+        // only records the image, the cells are computed by retrieve()
+        _img = img;
+        _n_cells_y = static_cast<int>(img.rows/_cellsize);
+        _n_cells_x = static_cast<int>(img.cols/_cellsize);
+        mag = cv::Mat::zeros(img.size(), CV_MAKETYPE(CV_32F, img.channels()));
+        ori = cv::Mat::zeros(img.size(), CV_MAKETYPE(CV_32F, img.channels()));
+        _cell_hists.assign(_n_cells_y, std::vector<HOG::THist>(_n_cells_x, HOG::THist(_binning, 0)));
+        _cell_valid.assign(_n_cells_y*_n_cells_x, 0);
+        _row_once.reset(new std::once_flag[_n_cells_y]);
+        return;
+    }
 
-    // extracts the magnitude and orientations images
-    magnitude_and_orientation(img);
+    prepare(img);
+    
+    // The image is split in bands of cell-rows processed in parallel. Each band
+    // computes its own gradients (the neighbouring rows are used as border) and then
+    // its cell histograms, so that the magnitude/orientation stay in cache.
+    // The bands are kept small enough to check the cancellation regularly.
+    Executor& exec = executor();
+    const size_t grain = std::min<size_t>(std::max<size_t>(1, _n_cells_y/(4*exec.concurrency())), max_band_rows);
+    std::mutex progress_mutex;
+    size_t n_rows_done = 0;
+    exec.parallel_for(0, _n_cells_y, grain, [&](const size_t begin, const size_t end) {
+        if(token.is_cancelled())
+            return;
+        process_rows(img, begin, end);
+        if(progress) {
+            std::lock_guard<std::mutex> lock(progress_mutex);
+            n_rows_done += end - begin;
+            progress(static_cast<float>(n_rows_done)/_n_cells_y);
+        }
+    });
     
-    _n_cells_y = static_cast<int>(mag.rows/_cellsize);
-    _n_cells_x = static_cast<int>(mag.cols/_cellsize);
+    if(token.is_cancelled()) {
+        clear_internals();
+        throw OperationCancelled("HOG::process(): cancelled!");
+    }
+    finalize();
+}
+
+void HOG::process_batch(const std::vector<cv::Mat>& images, std::vector<HOG>& hogs) const {
+    process_batch(images, hogs, CancellationToken());
+}
+
+void HOG::process_batch(const std::vector<cv::Mat>& images, std::vector<HOG>& hogs, 
+                        const CancellationToken& token, const ProgressCallback& progress) const {
+    
+    for(const auto& img : images) {
+        if(!img.data)
+            throw std::runtime_error("HOG::process_batch(): invalid image!");
+        if(img.rows < _blocksize || img.cols < _blocksize)
+            throw std::runtime_error("HOG::process_batch(): the image is smaller than blocksize!");
+    }
+    
+    // the assignment copies the parameters only, the buffers of the objects are reused
+    hogs.resize(images.size(), *this);
+    for(size_t k = 0; k < images.size(); ++k) {
+        hogs[k] = *this;
+        hogs[k].clear_internals();
+        hogs[k].prepare(images[k]);
+    }
+    
+    // Splits the work in tasks of similar cost (estimated from the number of pixels):
+    // the big images are cut in bands of cell-rows and the small ones are whole-image
+    // tasks. The tasks are run by the work-stealing executor, the biggest first, so 
+    // that all the threads are kept busy until the end of the batch.
+    struct Task {
+        size_t image;
+        size_t begin;
+        size_t end;
+        size_t cost;
+    };
+    Executor& exec = executor();
+    size_t total_cost = 0;
+    for(const auto& img : images)
+        total_cost += img.total();
+    const size_t target_cost = std::max<size_t>(1, total_cost/(4*exec.concurrency()));
+    
+    std::vector<Task> tasks;
+    for(size_t k = 0; k < images.size(); ++k) {
+        const size_t row_cost = images[k].cols*_cellsize;
+        const size_t rows_per_task = std::min<size_t>(std::max<size_t>(1, target_cost/row_cost), max_band_rows);
+        for(size_t begin = 0; begin < hogs[k]._n_cells_y; begin += rows_per_task) {
+            const size_t end = std::min(begin + rows_per_task, hogs[k]._n_cells_y);
+            tasks.push_back(Task{k, begin, end, (end-begin)*row_cost});
+        }
+    }
+    std::stable_sort(std::begin(tasks), std::end(tasks), [](const Task& a, const Task& b) {
+        return a.cost > b.cost;
+    });
+    
+    size_t tasks_cost = 0;
+    for(const auto& task : tasks)
+        tasks_cost += task.cost;
+    
+    std::mutex progress_mutex;
+    size_t cost_done = 0;
+    exec.parallel_for(0, tasks.size(), 1, [&](const size_t begin, const size_t end) {
+        for(size_t t = begin; t < end; ++t) {
+            if(token.is_cancelled())
+                return;
+            hogs[tasks[t].image].process_rows(images[tasks[t].image], tasks[t].begin, tasks[t].end);
+            if(progress) {
+                std::lock_guard<std::mutex> lock(progress_mutex);
+                cost_done += tasks[t].cost;
+                progress(static_cast<float>(cost_done)/tasks_cost);
+            }
+        }
+    });
     
+    if(token.is_cancelled()) {
+        for(auto& hog : hogs)
+            hog.clear_internals();
+        throw OperationCancelled("HOG::process_batch(): cancelled!");
+    }
+    for(auto& hog : hogs)
+        hog.finalize();
+}
+
+void HOG::prepare(const cv::Mat& img) {
+    _n_cells_y = static_cast<int>(img.rows/_cellsize);
+    _n_cells_x = static_cast<int>(img.cols/_cellsize);
+    mag.create(img.size(), CV_MAKETYPE(CV_32F, img.channels()));
+    ori.create(img.size(), CV_MAKETYPE(CV_32F, img.channels()));
     _cell_hists.resize(_n_cells_y);
+    _cell_valid.assign(_n_cells_y*_n_cells_x, 1);
+    _n_valid_cells = _cell_valid.size();
+}
+
+void HOG::set_lazy(const bool lazy) {
+    _lazy = lazy;
+}
+
+void HOG::set_executor(const std::shared_ptr<Executor>& executor) {
+    _executor = executor;
+}
+
+Executor& HOG::executor() const {
+    return _executor ? *_executor : *Executor::default_executor();
+}
+
+void HOG::process(const cv::Mat& img, const std::vector<cv::Rect>& rois) {
+    process(img, rois, CancellationToken());
+}
+
+void HOG::process(const cv::Mat& img, const std::vector<cv::Rect>& rois, 
+                  const CancellationToken& token, const ProgressCallback& progress) {
     
-    // iterates over all blocks and cells
-    // We tried to use OpenMP here but with scarce results. The function process_cell()
-    // doesn't consume a great deal of CPU so OpenMP struggle to spread the computation
-    // over multiple threads. The real time-consuming block of code here is the function retrieve().
-    for (size_t i = 0; i < _n_cells_y; ++i) {
-        _cell_hists[i].resize(_n_cells_x);
-        for (size_t j = 0; j < _n_cells_x; ++j) {
-            cv::Rect cell_rect = cv::Rect(j*_cellsize, i*_cellsize, _cellsize, _cellsize);
-            const HOG::THist cell_hist = process_cell(cv::Mat(mag, cell_rect), cv::Mat(ori, cell_rect));
-            _cell_hists[i][j] = cell_hist;
+    if(!img.data)
+        throw std::runtime_error("HOG::process(): invalid image!");
+    if(img.rows < _blocksize || img.cols < _blocksize)
+        throw std::runtime_error("HOG::process(): the image is smaller than blocksize!");
+    
+    // cleanup
+    clear_internals();
+    
+    _n_cells_y = static_cast<int>(img.rows/_cellsize);
+    _n_cells_x = static_cast<int>(img.cols/_cellsize);
+    
+    // the cells outside the ROIs are left empty
+    mag = cv::Mat::zeros(img.size(), CV_MAKETYPE(CV_32F, img.channels()));
+    ori = cv::Mat::zeros(img.size(), CV_MAKETYPE(CV_32F, img.channels()));
+    _cell_hists.assign(_n_cells_y, std::vector<HOG::THist>(_n_cells_x, HOG::THist(_binning, 0)));
+    
+    // marks the cells covered by at least one ROI
+    _cell_valid.assign(_n_cells_y*_n_cells_x, 0);
+    const cv::Rect grid(0, 0, _n_cells_x, _n_cells_y);
+    for(const auto& roi : rois) {
+        const cv::Rect r = roi & cv::Rect(0, 0, img.cols, img.rows);
+        if(r.width <= 0 || r.height <= 0)
+            continue;
+        const int cs = static_cast<int>(_cellsize);
+        const cv::Rect cells = cv::Rect(cv::Point(r.x/cs, r.y/cs), 
+                                        cv::Point((r.x+r.width-1)/cs+1, (r.y+r.height-1)/cs+1)) & grid;
+        for(int i = cells.y; i < cells.y+cells.height; ++i)
+            std::fill_n(std::begin(_cell_valid) + i*_n_cells_x + cells.x, cells.width, 1);
+    }
+    _n_valid_cells = std::count(std::begin(_cell_valid), std::end(_cell_valid), 1);
+    
+    // gradients and histograms are computed for each horizontal run of valid cells,
+    // the rows of cells are processed in parallel
+    std::mutex progress_mutex;
+    size_t n_rows_done = 0;
+    executor().parallel_for(0, _n_cells_y, 1, [&](const size_t begin, const size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            if(token.is_cancelled())
+                return;
+            const unsigned char* valid = &_cell_valid[i*_n_cells_x];
+            size_t j = 0;
+            while(j < _n_cells_x) {
+                if(!valid[j]) { 
+                    ++j;
+                    continue;
+                }
+                size_t run_end = j;
+                while(run_end < _n_cells_x && valid[run_end])
+                    ++run_end;
+                
+                magnitude_and_orientation(img, cv::Rect(j*_cellsize, i*_cellsize, (run_end-j)*_cellsize, _cellsize));
+                process_cells(i, j, run_end);
+                j = run_end;
+            }
+            if(progress) {
+                std::lock_guard<std::mutex> lock(progress_mutex);
+                progress(static_cast<float>(++n_rows_done)/_n_cells_y);
+            }
         }
+    });
+    
+    if(token.is_cancelled()) {
+        clear_internals();
+        throw OperationCancelled("HOG::process(): cancelled!");
+    }
+    finalize();
+}
+
+void HOG::update(const cv::Mat& img, const cv::Rect& dirty) {
+    update(img, std::vector<cv::Rect>{dirty});
+}
+
+void HOG::update(const cv::Mat& img, const std::vector<cv::Rect>& dirty) {
+    update(img, dirty, CancellationToken());
+}
+
+void HOG::update(const cv::Mat& img, const std::vector<cv::Rect>& dirty, 
+                 const CancellationToken& token, const ProgressCallback& progress) {
+    
+    if(!img.data)
+        throw std::runtime_error("HOG::update(): invalid image!");
+    if(_cell_valid.empty() || img.size() != mag.size())
+        throw std::runtime_error("HOG::update(): the image must have the same size of the processed one!");
+    
+    // in lazy mode the rows not computed yet will use the new image
+    if(_lazy)
+        _img = img;
+    
+    // marks the cells touched by the regions so that each cell is rebinned once
+    const int cs = static_cast<int>(_cellsize);
+    const cv::Rect grid = cv::Rect(0, 0, _n_cells_x, _n_cells_y);
+    std::vector<unsigned char> touched(_n_cells_y*_n_cells_x, 0);
+    std::vector<unsigned char> touched_rows(_n_cells_y, 0);
+    std::vector<cv::Rect> regions;
+    cv::Point first(_n_cells_x, _n_cells_y); // first touched cell, the derived tables change from there
+    for(const auto& d : dirty) {
+        // the derivative kernels are 3 pixels wide so the gradient changes 
+        // up to one pixel around the dirty region
+        const cv::Rect region = cv::Rect(d.x-1, d.y-1, d.width+2, d.height+2) & cv::Rect(0, 0, img.cols, img.rows);
+        if(region.width <= 0 || region.height <= 0)
+            continue;
+        regions.push_back(region);
         
+        const cv::Rect cells = cv::Rect(cv::Point(region.x/cs, region.y/cs), 
+                                        cv::Point((region.x+region.width-1)/cs+1, (region.y+region.height-1)/cs+1)) & grid;
+        for (int i = cells.y; i < cells.y+cells.height; ++i) {
+            std::fill_n(std::begin(touched) + i*_n_cells_x + cells.x, cells.width, 1);
+            touched_rows[i] = 1;
+        }
+        first.x = std::min(first.x, cells.x);
+        first.y = std::min(first.y, cells.y);
     }
+    
+    // one step for the gradients of each region and one for each row of touched cells
+    const size_t n_steps = regions.size() + std::count(std::begin(touched_rows), std::end(touched_rows), 1);
+    size_t n_steps_done = 0;
+    auto step_done = [&]() {
+        if(token.is_cancelled()) {
+            clear_internals();
+            throw OperationCancelled("HOG::update(): cancelled!");
+        }
+        if(progress)
+            progress(static_cast<float>(++n_steps_done)/n_steps);
+    };
+    
+    for(const auto& region : regions) {
+        magnitude_and_orientation(img, region);
+        step_done();
+    }
+    
+    // rebins the runs of valid cells touched by the regions
+    for (size_t i = 0; i < _n_cells_y; ++i) {
+        if(!touched_rows[i])
+            continue;
+        auto rebin = [&](const size_t j) { return touched[i*_n_cells_x + j] && _cell_valid[i*_n_cells_x + j]; };
+        size_t j = 0;
+        while(j < _n_cells_x) {
+            if(!rebin(j)) {
+                ++j;
+                continue;
+            }
+            size_t run_end = j;
+            while(run_end < _n_cells_x && rebin(run_end))
+                ++run_end;
+            process_cells(i, j, run_end);
+            j = run_end;
+        }
+        step_done();
+    }
+    finalize(first);
 }
 
-const HOG::THist HOG::retrieve(const cv::Rect& window) {
+cv::Rect HOG::window_cells(const cv::Rect& window, const std::string& caller) {
     
     if(window.height < _blocksize || window.width < _blocksize)
-        throw std::runtime_error("HOG::retrieve(): the window is smaller than blocksize!");
-    if(window.x > mag.cols-window.width || window.y > mag.rows-window.height)
-        throw std::runtime_error("HOG::retrieve(): the window goes outside of the bounds of the image!");
+        throw std::runtime_error(caller + ": the window is smaller than blocksize!");
+    if(window.x < 0 || window.y < 0 || window.x > mag.cols-window.width || window.y > mag.rows-window.height)
+        throw std::runtime_error(caller + ": the window goes outside of the bounds of the image!");
     
     // convert the window pixels into cell-units so we can iterate over 
     // the vector of vectors of cell histograms (_cell_hists)
@@ -222,15 +515,225 @@ const HOG::THist HOG::retrieve(const cv::Rect& window) {
     size_t width = static_cast<int>(window.width/_cellsize);
     size_t height = static_cast<int>(window.height/_cellsize);
     
-    // Also here we tried to use OpenMP but with scarce results.
+    // lazy mode: computes the rows of cells touched by the window (only once)
+    if(_row_once) {
+        for(size_t i = y; i < y+height; ++i)
+            std::call_once(_row_once[i], &HOG::process_row, this, i);
+    }
+    
+    if(!cells_valid(cv::Rect(x, y, width, height)))
+        throw std::runtime_error(caller + ": the window goes outside of the processed area!");
+    return cv::Rect(x, y, width, height);
+}
+
+const HOG::THist HOG::retrieve(const cv::Rect& window) {
     HOG::THist hog_hist;
+    retrieve(window, hog_hist);
+    return hog_hist;
+}
+
+void HOG::retrieve(const cv::Rect& window, THist& out) {
+    
+    const cv::Rect cells = window_cells(window, "HOG::retrieve()");
+    const size_t x = cells.x;
+    const size_t y = cells.y;
+    const size_t width = cells.width;
+    const size_t height = cells.height;
+    
+    if(_rotation_normalization) {
+        out = retrieve_rotated(cv::Rect(x, y, width, height));
+        return;
+    }
+    
+    // Also here we tried to use OpenMP but with scarce results.
+    // The block buffer is kept by the thread to stream windows without allocations.
+    thread_local HOG::THist block_hist;
+    out.clear();
     for(size_t block_y=y; block_y<=y+height-_n_cells_per_block_y; block_y += _stride_unit) {
         for(size_t block_x=x; block_x<=x+width-_n_cells_per_block_x; block_x += _stride_unit) {
-            HOG::THist block_hist;
-            block_hist.reserve(_block_hist_size);
+            build_block(block_y, block_x, block_hist);
+            out.insert(std::end(out), std::begin(block_hist), std::end(block_hist));
+        }
+    }
+}
+
+void HOG::retrieve(const cv::Rect& window, const Layout& layout, TType* out) {
+    
+    if(layout.padding == 0)
+        throw std::runtime_error("HOG::retrieve(): the padding of the layout must be at least 1!");
+    if(layout.alignment > 0 && reinterpret_cast<uintptr_t>(out) % layout.alignment != 0)
+        throw std::runtime_error("HOG::retrieve(): the output is not aligned as required by the layout!");
+    const cv::Rect cells = window_cells(window, "HOG::retrieve()");
+    
+    auto round_up = [&](const size_t n) { return (n + layout.padding - 1)/layout.padding*layout.padding; };
+    const size_t n_blocks = this->n_blocks(window.size());
+    const size_t block_stride = round_up(_block_hist_size);
+    const size_t n_block_cells = n_blocks*_n_cells_per_block;
+    const size_t channel_stride = round_up(n_block_cells);
+    std::fill(out, out + descriptor_size(window.size(), layout), TType(0));
+    
+    // copies the k-th block where the layout wants it
+    auto place = [&](const size_t k, const TType* block_hist) {
+        if(layout.order == Layout::ORDER::block_major) {
+            std::copy(block_hist, block_hist + _block_hist_size, out + k*block_stride);
+        } else {
+            for(size_t c = 0; c < _n_cells_per_block; ++c)
+                for(size_t b = 0; b < _binning; ++b)
+                    out[b*channel_stride + k*_n_cells_per_block + c] = block_hist[c*_binning + b];
+        }
+    };
+    
+    if(_rotation_normalization) {
+        const THist hog_hist = retrieve_rotated(cells);
+        for(size_t k = 0; k < n_blocks; ++k)
+            place(k, hog_hist.data() + k*_block_hist_size);
+        return;
+    }
+    
+    thread_local HOG::THist block_hist;
+    size_t k = 0;
+    for(size_t block_y=cells.y; block_y<=cells.y+cells.height-_n_cells_per_block_y; block_y += _stride_unit) {
+        for(size_t block_x=cells.x; block_x<=cells.x+cells.width-_n_cells_per_block_x; block_x += _stride_unit) {
+            build_block(block_y, block_x, block_hist);
+            place(k++, block_hist.data());
+        }
+    }
+}
+
+void HOG::retrieve(const cv::Rect& window, const Layout& layout, THist& out) {
+    // std::vector only guarantees the alignment of its element type
+    if(layout.alignment > alignof(TType))
+        throw std::runtime_error("HOG::retrieve(): a std::vector can't guarantee the alignment of the layout!");
+    out.resize(descriptor_size(window.size(), layout));
+    retrieve(window, layout, out.data());
+}
+
+const HOG::THist HOG::retrieve_resampled(const cv::Rect& window, const size_t out_cells_y, const size_t out_cells_x) {
+    
+    if(window.height < _cellsize || window.width < _cellsize)
+        throw std::runtime_error("HOG::retrieve_resampled(): the window is smaller than cellsize!");
+    if(window.x < 0 || window.y < 0 || window.x > mag.cols-window.width || window.y > mag.rows-window.height)
+        throw std::runtime_error("HOG::retrieve_resampled(): the window goes outside of the bounds of the image!");
+    if(out_cells_y < _n_cells_per_block_y || out_cells_x < _n_cells_per_block_x)
+        throw std::runtime_error("HOG::retrieve_resampled(): the output grid is smaller than a block!");
+    
+    // window in cell-units, as in HOG::retrieve()
+    const size_t x = window.x/_cellsize;
+    const size_t y = window.y/_cellsize;
+    const size_t width = window.width/_cellsize;
+    const size_t height = window.height/_cellsize;
+    
+    if(_row_once) {
+        for(size_t i = y; i < y+height; ++i)
+            std::call_once(_row_once[i], &HOG::process_row, this, i);
+    }
+    if(!cells_valid(cv::Rect(x, y, width, height)))
+        throw std::runtime_error("HOG::retrieve_resampled(): the window goes outside of the processed area!");
+    
+    // overlap of each output cell with the cells of the window along one axis:
+    // the output cell k covers [k*n/out, (k+1)*n/out) in cells of the window
+    struct Weight {
+        size_t cell;
+        TType weight;
+    };
+    auto weights = [](const size_t n, const size_t out) {
+        std::vector<std::vector<Weight>> w(out);
+        const double step = static_cast<double>(n)/out;
+        for(size_t k = 0; k < out; ++k) {
+            const double begin = k*step;
+            const double end = (k+1)*step;
+            for(size_t i = static_cast<size_t>(begin); i < n && i < end; ++i) {
+                const double overlap = std::min<double>(i+1, end) - std::max<double>(i, begin);
+                if(overlap > 0)
+                    w[k].push_back(Weight{i, static_cast<TType>(overlap/step)});
+            }
+        }
+        return w;
+    };
+    const auto weights_y = weights(height, out_cells_y);
+    const auto weights_x = weights(width, out_cells_x);
+    
+    // area-weighted mean of the cells covered by each output cell
+    std::vector<THist> cells(out_cells_y*out_cells_x, THist(_binning, 0));
+    for(size_t r = 0; r < out_cells_y; ++r) {
+        for(size_t c = 0; c < out_cells_x; ++c) {
+            THist& out = cells[r*out_cells_x + c];
+            for(const auto& wy : weights_y[r]) {
+                for(const auto& wx : weights_x[c]) {
+                    const TType w = wy.weight*wx.weight;
+                    const THist& cell_hist = _cell_hists[y+wy.cell][x+wx.cell];
+                    for(size_t k = 0; k < _binning; ++k)
+                        out[k] += w*cell_hist[k];
+                }
+            }
+        }
+    }
+    
+    if(_rotation_normalization)
+        cells = rotate_grid(cells, out_cells_y, out_cells_x);
+    return grid_blocks(cells, out_cells_y, out_cells_x);
+}
+
+const HOG::THist HOG::retrieve_rotated(const cv::Rect& cells) const {
+    std::vector<THist> grid;
+    grid.reserve(cells.height*cells.width);
+    for(int i = cells.y; i < cells.y+cells.height; ++i)
+        grid.insert(std::end(grid), std::begin(_cell_hists[i]) + cells.x, std::begin(_cell_hists[i]) + cells.x+cells.width);
+    return grid_blocks(rotate_grid(grid, cells.height, cells.width), cells.height, cells.width);
+}
+
+std::vector<HOG::THist> HOG::rotate_grid(const std::vector<THist>& grid, const size_t height, const size_t width) const {
+    
+    // dominant orientation of the grid
+    THist grid_hist(_binning, 0);
+    for(const auto& cell_hist : grid)
+        std::transform(std::begin(grid_hist), std::end(grid_hist), std::begin(cell_hist), std::begin(grid_hist), std::plus<TType>());
+    const size_t dominant = std::distance(std::begin(grid_hist), std::max_element(std::begin(grid_hist), std::end(grid_hist)));
+    
+    // number of rotations of 90° bringing the dominant orientation closest to 0. A grid 
+    // that isn't square can only turn by 180° and an unsigned gradient can't tell 180° 
+    // apart. The turn must be a whole number of bins to match the shift of the bins.
+    const size_t step = height == width ? 90 : 180;
+    size_t quarters = 0;
+    if((step*_binning) % _grad_type == 0) {
+        const size_t bins_per_step = step*_binning/_grad_type;
+        const size_t n_steps = _grad_type/step;
+        quarters = (static_cast<size_t>(std::round(static_cast<double>(dominant)/bins_per_step)) % n_steps)*step/90;
+    }
+    
+    // the cells of the grid turned counter-clockwise, the bins shifted so that
+    // the dominant orientation is the first bin
+    std::vector<THist> rotated(height*width, THist(_binning));
+    for(size_t r = 0; r < height; ++r) {
+        for(size_t c = 0; c < width; ++c) {
+            size_t src_r = r, src_c = c;
+            if(quarters == 1) {
+                src_r = c;
+                src_c = width-1-r;
+            } else if(quarters == 2) {
+                src_r = height-1-r;
+                src_c = width-1-c;
+            } else if(quarters == 3) {
+                src_r = height-1-c;
+                src_c = r;
+            }
+            const THist& cell_hist = grid[src_r*width + src_c];
+            std::rotate_copy(std::begin(cell_hist), std::begin(cell_hist)+dominant, std::end(cell_hist), std::begin(rotated[r*width+c]));
+        }
+    }
+    return rotated;
+}
+
+const HOG::THist HOG::grid_blocks(const std::vector<THist>& grid, const size_t height, const size_t width) const {
+    HOG::THist hog_hist;
+    HOG::THist block_hist;
+    block_hist.reserve(_block_hist_size);
+    for(size_t block_y=0; block_y<=height-_n_cells_per_block_y; block_y += _stride_unit) {
+        for(size_t block_x=0; block_x<=width-_n_cells_per_block_x; block_x += _stride_unit) {
+            block_hist.clear();
             for(size_t cell_y=block_y; cell_y<block_y+_n_cells_per_block_y; ++cell_y) {
                 for(size_t cell_x=block_x; cell_x<block_x+_n_cells_per_block_x; ++cell_x) {
-                    const THist cell_hist = _cell_hists[cell_y][cell_x];
+                    const THist& cell_hist = grid[cell_y*width+cell_x];
                     block_hist.insert(std::end(block_hist), std::begin(cell_hist), std::end(cell_hist));
                 }
             }
@@ -241,6 +744,162 @@ const HOG::THist HOG::retrieve(const cv::Rect& window) {
     return hog_hist;
 }
 
+void HOG::set_rotation_normalization(const bool enable) {
+    _rotation_normalization = enable;
+}
+
+const std::vector<HOG::THist> HOG::retrieve_many(const std::vector<cv::Rect>& windows) {
+    
+    // windows in cell-units, as in HOG::retrieve()
+    std::vector<cv::Rect> cells(windows.size());
+    for(size_t k = 0; k < windows.size(); ++k) {
+        const cv::Rect& window = windows[k];
+        if(window.height < _blocksize || window.width < _blocksize)
+            throw std::runtime_error("HOG::retrieve_many(): the window is smaller than blocksize!");
+        if(window.x < 0 || window.y < 0 || window.x > mag.cols-window.width || window.y > mag.rows-window.height)
+            throw std::runtime_error("HOG::retrieve_many(): the window goes outside of the bounds of the image!");
+        cells[k] = cv::Rect(window.x/_cellsize, window.y/_cellsize, window.width/_cellsize, window.height/_cellsize);
+        if(_row_once) {
+            for(int i = cells[k].y; i < cells[k].y+cells[k].height; ++i)
+                std::call_once(_row_once[i], &HOG::process_row, this, i);
+        }
+        if(!cells_valid(cells[k]))
+            throw std::runtime_error("HOG::retrieve_many(): the window goes outside of the processed area!");
+    }
+    
+    // the rotation depends on the whole window: the windows can't share their blocks
+    Executor& exec = executor();
+    if(_rotation_normalization) {
+        std::vector<THist> hists(windows.size());
+        exec.parallel_for(0, windows.size(), 1, [&](const size_t begin, const size_t end) {
+            for(size_t k = begin; k < end; ++k)
+                hists[k] = retrieve_rotated(cells[k]);
+        });
+        return hists;
+    }
+    
+    // the windows are assembled in Morton order of their origin so that
+    // consecutive windows share most of their blocks
+    std::vector<size_t> order(windows.size());
+    std::iota(std::begin(order), std::end(order), 0);
+    std::vector<uint64_t> codes(windows.size());
+    for(size_t k = 0; k < windows.size(); ++k)
+        codes[k] = morton_code(cells[k].y, cells[k].x);
+    std::stable_sort(std::begin(order), std::end(order), [&](const size_t a, const size_t b) { 
+        return codes[a] < codes[b]; 
+    });
+    
+    // distinct blocks (top-left cells) needed by the windows, in the same order
+    const size_t none = std::numeric_limits<size_t>::max();
+    std::vector<size_t> block_index(_n_cells_y*_n_cells_x, none);
+    std::vector<size_t> blocks;
+    for(const auto k : order) {
+        const cv::Rect& c = cells[k];
+        for(size_t block_y = c.y; block_y <= c.y+c.height-_n_cells_per_block_y; block_y += _stride_unit) {
+            for(size_t block_x = c.x; block_x <= c.x+c.width-_n_cells_per_block_x; block_x += _stride_unit) {
+                size_t& index = block_index[block_y*_n_cells_x + block_x];
+                if(index == none) {
+                    index = blocks.size();
+                    blocks.push_back(block_y*_n_cells_x + block_x);
+                }
+            }
+        }
+    }
+    
+    // each block is normalized once
+    std::vector<TType> normalized(blocks.size()*_block_hist_size);
+    const size_t grain = std::max<size_t>(1, blocks.size()/(4*exec.concurrency()));
+    exec.parallel_for(0, blocks.size(), grain, [&](const size_t begin, const size_t end) {
+        THist block_hist;
+        block_hist.reserve(_block_hist_size);
+        for(size_t b = begin; b < end; ++b) {
+            build_block(blocks[b]/_n_cells_x, blocks[b]%_n_cells_x, block_hist);
+            std::copy(std::begin(block_hist), std::end(block_hist), std::begin(normalized) + b*_block_hist_size);
+        }
+    });
+    
+    std::vector<THist> hists(windows.size());
+    exec.parallel_for(0, order.size(), std::max<size_t>(1, order.size()/(4*exec.concurrency())), 
+                      [&](const size_t begin, const size_t end) {
+        for(size_t o = begin; o < end; ++o) {
+            const size_t k = order[o];
+            const cv::Rect& c = cells[k];
+            THist& hist = hists[k];
+            hist.reserve(descriptor_size(windows[k].size()));
+            for(size_t block_y = c.y; block_y <= c.y+c.height-_n_cells_per_block_y; block_y += _stride_unit) {
+                for(size_t block_x = c.x; block_x <= c.x+c.width-_n_cells_per_block_x; block_x += _stride_unit) {
+                    auto first = std::begin(normalized) + block_index[block_y*_n_cells_x + block_x]*_block_hist_size;
+                    hist.insert(std::end(hist), first, first + _block_hist_size);
+                }
+            }
+        }
+    });
+    return hists;
+}
+
+void HOG::retrieve_block(const cv::Rect& window, const size_t block, THist& block_hist) {
+    
+    if(window.height < _blocksize || window.width < _blocksize)
+        throw std::runtime_error("HOG::retrieve_block(): the window is smaller than blocksize!");
+    if(block >= n_blocks(window.size()))
+        throw std::runtime_error("HOG::retrieve_block(): the block is outside of the window!");
+    if(_rotation_normalization)
+        throw std::runtime_error("HOG::retrieve_block(): not available with the rotation normalization!");
+    if(window.x < 0 || window.y < 0 || window.x > mag.cols-window.width || window.y > mag.rows-window.height)
+        throw std::runtime_error("HOG::retrieve_block(): the window goes outside of the bounds of the image!");
+    
+    // top-left cell of the block, the blocks are in the same order as in HOG::retrieve()
+    const size_t n_blocks_x = (window.width/_cellsize - _n_cells_per_block_x)/_stride_unit + 1;
+    const size_t block_y = window.y/_cellsize + (block/n_blocks_x)*_stride_unit;
+    const size_t block_x = window.x/_cellsize + (block%n_blocks_x)*_stride_unit;
+    
+    if(_row_once) {
+        for(size_t i = block_y; i < block_y+_n_cells_per_block_y; ++i)
+            std::call_once(_row_once[i], &HOG::process_row, this, i);
+    }
+    
+    if(!cells_valid(cv::Rect(block_x, block_y, _n_cells_per_block_x, _n_cells_per_block_y)))
+        throw std::runtime_error("HOG::retrieve_block(): the block goes outside of the processed area!");
+    
+    build_block(block_y, block_x, block_hist);
+}
+
+void HOG::build_block(const size_t block_y, const size_t block_x, THist& block_hist) const {
+    if(!_norm_integral.empty()) {
+        // L2norm (and first step of L2hys): the norm of the block is read from the 
+        // summed-area table, the cells are copied then the whole block is scaled
+        const size_t block_x_end = block_x + _n_cells_per_block_x;
+        const double* top = _norm_integral.ptr<double>(block_y);
+        const double* bottom = _norm_integral.ptr<double>(block_y + _n_cells_per_block_y);
+        const double squared_norm = bottom[block_x_end] - bottom[block_x] - top[block_x_end] + top[block_x];
+        const TType scale = 1 / std::sqrt(static_cast<TType>(std::max(squared_norm, 0.0)) + epsilon);
+        const HOGKernels& kernels = hog_kernels();
+        block_hist.resize(_block_hist_size);
+        TType* out = block_hist.data();
+        for(size_t cell_y=block_y; cell_y<block_y+_n_cells_per_block_y; ++cell_y) {
+            for(size_t cell_x=block_x; cell_x<block_x_end; ++cell_x) {
+                const THist& cell_hist = _cell_hists[cell_y][cell_x];
+                out = std::copy(std::begin(cell_hist), std::end(cell_hist), out);
+            }
+        }
+        kernels.scale(block_hist.data(), block_hist.data(), block_hist.size(), scale);
+        if(_norm_function == BLOCK_NORM::L2hys) {
+            kernels.clip(block_hist.data(), block_hist.size(), 0.0f, 0.2f);
+            HOG::L2norm(block_hist);
+        }
+        return;
+    }
+    
+    block_hist.clear();
+    for(size_t cell_y=block_y; cell_y<block_y+_n_cells_per_block_y; ++cell_y) {
+        for(size_t cell_x=block_x; cell_x<block_x+_n_cells_per_block_x; ++cell_x) {
+            const THist& cell_hist = _cell_hists[cell_y][cell_x];
+            block_hist.insert(std::end(block_hist), std::begin(cell_hist), std::end(cell_hist));
+        }
+    }
+    _block_norm(block_hist);
+}
+
 void HOG::magnitude_and_orientation(const cv::Mat& img) {
     cv::Mat Dx, Dy;
     cv::filter2D(img, Dx, CV_32F, _kernelx);
@@ -249,29 +908,175 @@ void HOG::magnitude_and_orientation(const cv::Mat& img) {
     cv::phase(Dx, Dy, ori, true);
 }
 
-const HOG::THist HOG::process_cell(const cv::Mat& cell_mag, const cv::Mat& cell_ori) {
-    HOG::THist cell_hist(_binning);
-    if(_grad_type == GRADIENT_SIGNED) {
-        for (size_t i = 0; i < cell_mag.rows; ++i) {
-            const HOG::TType* ptr_row_mag = cell_mag.ptr<HOG::TType>(i);
-            const HOG::TType* ptr_row_ori = cell_ori.ptr<HOG::TType>(i);
-            for (size_t j = 0; j < cell_mag.cols; ++j) {
-                cell_hist.at(static_cast<int>(ptr_row_ori[j] / _bin_width)) += ptr_row_mag[j];
-            }
+void HOG::magnitude_and_orientation(const cv::Mat& img, const cv::Rect& rect) {
+    // filter2D() on a sub-matrix uses the surrounding pixels of the parent image as border
+    cv::Mat Dx, Dy;
+    cv::filter2D(cv::Mat(img, rect), Dx, CV_32F, _kernelx);
+    cv::filter2D(cv::Mat(img, rect), Dy, CV_32F, _kernely);
+    cv::Mat mag_rect(mag, rect);
+    cv::Mat ori_rect(ori, rect);
+    cv::magnitude(Dx, Dy, mag_rect);
+    cv::phase(Dx, Dy, ori_rect, true);
+}
+
+void HOG::process_rows(const cv::Mat& img, const size_t begin, const size_t end) {
+    // the last band also covers the pixels left over at the bottom of the image
+    const size_t y_end = end == _n_cells_y ? img.rows : end*_cellsize;
+    magnitude_and_orientation(img, cv::Rect(0, begin*_cellsize, img.cols, y_end - begin*_cellsize));
+    for (size_t i = begin; i < end; ++i) {
+        _cell_hists[i].resize(_n_cells_x);
+        process_cells(i, 0, _n_cells_x);
+    }
+}
+
+void HOG::process_row(const size_t cell_y) {
+    process_rows(_img, cell_y, cell_y+1);
+    std::fill_n(std::begin(_cell_valid) + cell_y*_n_cells_x, _n_cells_x, 1);
+}
+
+bool HOG::cells_valid(const cv::Rect& cells) const {
+    if(_n_valid_cells == _cell_valid.size())
+        return true;
+    for(int i = cells.y; i < cells.y+cells.height; ++i) {
+        const auto row = std::begin(_cell_valid) + i*_n_cells_x;
+        if(std::find(row + cells.x, row + cells.x + cells.width, 0) != row + cells.x + cells.width)
+            return false;
+    }
+    return true;
+}
+
+void HOG::process_cells(const size_t cell_y, const size_t cell_begin, const size_t cell_end) {
+    // the bins of a whole row of pixels of the run are computed at once
+    // (vectorized), an unsigned orientation is folded in 0..180 first
+    const HOGKernels& kernels = hog_kernels();
+    const TType fold = _grad_type == GRADIENT_SIGNED ? 360 : 180;
+    const size_t x_begin = cell_begin*_cellsize;
+    const size_t n = (cell_end - cell_begin)*_cellsize;
+    static thread_local std::vector<int> bins;
+    bins.resize(n);
+    std::vector<THist>& cell_row = _cell_hists[cell_y];
+    for (size_t j = cell_begin; j < cell_end; ++j)
+        cell_row[j].assign(_binning, 0);
+    for (size_t i = cell_y*_cellsize; i < (cell_y+1)*_cellsize; ++i) {
+        const HOG::TType* ptr_row_mag = mag.ptr<HOG::TType>(i) + x_begin;
+        const HOG::TType* ptr_row_ori = ori.ptr<HOG::TType>(i) + x_begin;
+        kernels.bin_indices(ptr_row_ori, bins.data(), n, _bin_width, fold, _binning-1);
+        for (size_t j = cell_begin; j < cell_end; ++j) {
+            HOG::TType* cell_hist = cell_row[j].data();
+            const size_t offset = (j - cell_begin)*_cellsize;
+            for (size_t k = offset; k < offset + _cellsize; ++k)
+                cell_hist[bins[k]] += ptr_row_mag[k];
         }
-    } else {
-        for (size_t i = 0; i < cell_mag.rows; ++i) {
-            const HOG::TType* ptr_row_mag = cell_mag.ptr<HOG::TType>(i);
-            const HOG::TType* ptr_row_ori = cell_ori.ptr<HOG::TType>(i);
-            for (size_t j = 0; j < cell_mag.cols; ++j) {
-                HOG::TType orientation = ptr_row_ori[j];
-                if(orientation >= 180)
-                    orientation -= 180;
-                cell_hist.at(static_cast<int>(orientation / _bin_width)) += ptr_row_mag[j];
-            }
+    }
+}
+
+void HOG::finalize(const cv::Point& first) {
+    // lazy mode: the cells are not computed yet
+    if(_row_once)
+        return;
+    
+    // summed-area table of a value computed on each cell. A change of the cells from 
+    // (y0,x0) onward only modifies the entries below and on the right of it, so the 
+    // rest of an existing table is kept.
+    auto summed_area = [&](cv::Mat& table, size_t y0, size_t x0, auto cell_value) {
+        if(table.rows != _n_cells_y+1 || table.cols != _n_cells_x+1) {
+            table = cv::Mat::zeros(_n_cells_y+1, _n_cells_x+1, CV_64F);
+            y0 = 0;
+            x0 = 0;
         }
+        for(size_t i = y0; i < _n_cells_y; ++i) {
+            const double* prev_row = table.ptr<double>(i);
+            double* row = table.ptr<double>(i+1);
+            for(size_t j = x0; j < _n_cells_x; ++j)
+                row[j+1] = row[j] + prev_row[j+1] - prev_row[j] + cell_value(_cell_hists[i][j]);
+        }
+    };
+    
+    if(_energy_map) {
+        // energy of a cell: sum of its histogram
+        summed_area(_energy_integral, first.y, first.x, [](const THist& hist) {
+            return std::accumulate(std::begin(hist), std::end(hist), 0.0);
+        });
+    }
+    if(_norm_function == BLOCK_NORM::L2norm || _norm_function == BLOCK_NORM::L2hys) {
+        // squared norm of a cell: the squared norm of a block is the sum over its cells
+        summed_area(_norm_integral, first.y, first.x, [](const THist& hist) {
+            return std::inner_product(std::begin(hist), std::end(hist), std::begin(hist), 0.0);
+        });
     }
-    return cell_hist;
+}
+
+void HOG::set_energy_map(const bool enable) {
+    _energy_map = enable;
+}
+
+HOG::TType HOG::window_energy(const cv::Rect& window) const {
+    if(_energy_integral.empty())
+        throw std::runtime_error("HOG::window_energy(): the energy map is not available (see HOG::set_energy_map())!");
+    if(window.x < 0 || window.y < 0 || window.x > mag.cols-window.width || window.y > mag.rows-window.height)
+        throw std::runtime_error("HOG::window_energy(): the window goes outside of the bounds of the image!");
+    
+    // in cell-units, as in HOG::retrieve()
+    const int x = window.x/_cellsize;
+    const int y = window.y/_cellsize;
+    const int x_end = std::min<int>(x + window.width/_cellsize, _n_cells_x);
+    const int y_end = std::min<int>(y + window.height/_cellsize, _n_cells_y);
+    if(!cells_valid(cv::Rect(x, y, x_end-x, y_end-y)))
+        throw std::runtime_error("HOG::window_energy(): the window goes outside of the processed area!");
+    return _energy_integral.at<double>(y_end, x_end) - _energy_integral.at<double>(y, x_end)
+         - _energy_integral.at<double>(y_end, x) + _energy_integral.at<double>(y, x);
+}
+
+std::vector<cv::Rect> HOG::windows_above_energy(const cv::Size& window, const size_t stride, const TType min_energy) const {
+    if(stride == 0 || stride%_cellsize != 0)
+        throw std::runtime_error("HOG::windows_above_energy(): stride must be a multiple of cellsize!");
+    
+    std::vector<cv::Rect> windows;
+    for(int y = 0; y <= mag.rows - window.height; y += stride) {
+        for(int x = 0; x <= mag.cols - window.width; x += stride) {
+            // only the windows that HOG::retrieve() accepts (ROI mode)
+            const cv::Rect r(x, y, window.width, window.height);
+            const cv::Rect cells(x/_cellsize, y/_cellsize, 
+                                 std::min<int>(window.width/_cellsize, _n_cells_x - x/_cellsize), 
+                                 std::min<int>(window.height/_cellsize, _n_cells_y - y/_cellsize));
+            if(cells_valid(cells) && window_energy(r) >= min_energy)
+                windows.push_back(r);
+        }
+    }
+    return windows;
+}
+
+HOG::WindowRange HOG::windows(const cv::Size& window, const size_t stride) {
+    if(stride == 0 || stride%_cellsize != 0)
+        throw std::runtime_error("HOG::windows(): stride must be a multiple of cellsize!");
+    
+    const size_t n_windows_x = window.width <= mag.cols ? (mag.cols - window.width)/stride + 1 : 0;
+    const size_t n_windows_y = window.height <= mag.rows ? (mag.rows - window.height)/stride + 1 : 0;
+    return WindowRange(this, window, stride, n_windows_x, n_windows_y);
+}
+
+size_t HOG::n_blocks(const cv::Size& window) const {
+    const size_t height = window.height/_cellsize;
+    const size_t width = window.width/_cellsize;
+    if(height < _n_cells_per_block_y || width < _n_cells_per_block_x)
+        return 0;
+    const size_t n_blocks_y = (height - _n_cells_per_block_y)/_stride_unit + 1;
+    const size_t n_blocks_x = (width - _n_cells_per_block_x)/_stride_unit + 1;
+    return n_blocks_y*n_blocks_x;
+}
+
+size_t HOG::descriptor_size(const cv::Size& window) const {
+    return n_blocks(window)*_block_hist_size;
+}
+
+size_t HOG::descriptor_size(const cv::Size& window, const Layout& layout) const {
+    if(layout.padding == 0)
+        throw std::runtime_error("HOG::descriptor_size(): the padding of the layout must be at least 1!");
+    auto round_up = [&](const size_t n) { return (n + layout.padding - 1)/layout.padding*layout.padding; };
+    if(layout.order == Layout::ORDER::block_major)
+        return n_blocks(window)*round_up(_block_hist_size);
+    else
+        return _binning*round_up(n_blocks(window)*_n_cells_per_block);
 }
 
 const cv::Mat HOG::get_magnitudes() {
@@ -282,6 +1087,122 @@ const cv::Mat HOG::get_orientations() {
     return ori;
 }
 
+const std::vector<cv::Mat> HOG::get_cell_map() {
+    if(_row_once) {
+        for(size_t i = 0; i < _n_cells_y; ++i)
+            std::call_once(_row_once[i], &HOG::process_row, this, i);
+    }
+    
+    std::vector<cv::Mat> planes(_binning);
+    for(auto& plane : planes)
+        plane.create(_n_cells_y, _n_cells_x, CV_32F);
+    for(size_t i = 0; i < _n_cells_y; ++i) {
+        for(size_t j = 0; j < _n_cells_x; ++j) {
+            const THist& cell_hist = _cell_hists[i][j];
+            for(size_t k = 0; k < _binning; ++k)
+                planes[k].at<TType>(i, j) = cell_hist[k];
+        }
+    }
+    return planes;
+}
+
+const cv::Mat HOG::get_block_map() {
+    if(_rotation_normalization)
+        throw std::runtime_error("HOG::get_block_map(): not available with the rotation normalization!");
+    if(_row_once) {
+        for(size_t i = 0; i < _n_cells_y; ++i)
+            std::call_once(_row_once[i], &HOG::process_row, this, i);
+    }
+    if(_n_cells_y < _n_cells_per_block_y || _n_cells_x < _n_cells_per_block_x)
+        return cv::Mat(0, _block_hist_size, CV_32F);
+    
+    const size_t n_blocks_y = _n_cells_y - _n_cells_per_block_y + 1;
+    const size_t n_blocks_x = _n_cells_x - _n_cells_per_block_x + 1;
+    cv::Mat blocks(n_blocks_y*n_blocks_x, _block_hist_size, CV_32F);
+    executor().parallel_for(0, n_blocks_y, 1, [&](const size_t begin, const size_t end) {
+        THist block_hist;
+        block_hist.reserve(_block_hist_size);
+        for(size_t i = begin; i < end; ++i) {
+            for(size_t j = 0; j < n_blocks_x; ++j) {
+                build_block(i, j, block_hist);
+                std::copy(std::begin(block_hist), std::end(block_hist), blocks.ptr<TType>(i*n_blocks_x + j));
+            }
+        }
+    });
+    return blocks;
+}
+
+const std::vector<cv::Mat> HOG::get_fhog() {
+    if(_row_once) {
+        for(size_t i = 0; i < _n_cells_y; ++i)
+            std::call_once(_row_once[i], &HOG::process_row, this, i);
+    }
+    if(_n_cells_y < 3 || _n_cells_x < 3)
+        throw std::runtime_error("HOG::get_fhog(): the image must be at least 3x3 cells!");
+    
+    // signed histograms of 18 bins, one plane per bin, from the gradients already computed
+    const size_t n_signed = 18;
+    const size_t n_unsigned = n_signed/2;
+    std::vector<cv::Mat> signed_hists(n_signed);
+    for(auto& plane : signed_hists)
+        plane = cv::Mat::zeros(_n_cells_y, _n_cells_x, CV_32F);
+    executor().parallel_for(0, _n_cells_y, 1, [&](const size_t begin, const size_t end) {
+        for(size_t i = begin; i < end; ++i) {
+            for(size_t y = i*_cellsize; y < (i+1)*_cellsize; ++y) {
+                const TType* ptr_row_mag = mag.ptr<TType>(y);
+                const TType* ptr_row_ori = ori.ptr<TType>(y);
+                for(size_t x = 0; x < _n_cells_x*_cellsize; ++x) {
+                    const size_t bin = std::min(static_cast<size_t>(ptr_row_ori[x]*n_signed/360), n_signed-1);
+                    signed_hists[bin].at<TType>(i, x/_cellsize) += ptr_row_mag[x];
+                }
+            }
+        }
+    });
+    
+    // the unsigned histograms are the fold of the signed ones
+    std::vector<cv::Mat> unsigned_hists(n_unsigned);
+    cv::Mat energy = cv::Mat::zeros(_n_cells_y, _n_cells_x, CV_32F);
+    for(size_t b = 0; b < n_unsigned; ++b) {
+        unsigned_hists[b] = signed_hists[b] + signed_hists[b+n_unsigned];
+        energy += unsigned_hists[b].mul(unsigned_hists[b]);
+    }
+    
+    // inverse norm of each 2x2 block of cells, then the 4 blocks around each inner cell
+    const int rows = _n_cells_y-2;
+    const int cols = _n_cells_x-2;
+    cv::Mat blocks = energy(cv::Rect(0, 0, _n_cells_x-1, _n_cells_y-1)) + energy(cv::Rect(1, 0, _n_cells_x-1, _n_cells_y-1))
+                   + energy(cv::Rect(0, 1, _n_cells_x-1, _n_cells_y-1)) + energy(cv::Rect(1, 1, _n_cells_x-1, _n_cells_y-1));
+    cv::Mat inv_norms;
+    cv::sqrt(blocks + epsilon, inv_norms);
+    cv::divide(1.0, inv_norms, inv_norms);
+    const cv::Mat norms[4] = {inv_norms(cv::Rect(0, 0, cols, rows)), inv_norms(cv::Rect(1, 0, cols, rows)),
+                              inv_norms(cv::Rect(0, 1, cols, rows)), inv_norms(cv::Rect(1, 1, cols, rows))};
+    
+    std::vector<cv::Mat> features(n_signed + n_unsigned + 4);
+    for(size_t k = n_signed + n_unsigned; k < features.size(); ++k)
+        features[k] = cv::Mat::zeros(rows, cols, CV_32F);
+    cv::Mat truncated;
+    auto contrast = [&](const cv::Mat& hist, cv::Mat& feature, const bool texture) {
+        const cv::Mat inner = hist(cv::Rect(1, 1, cols, rows));
+        feature = cv::Mat::zeros(rows, cols, CV_32F);
+        for(size_t k = 0; k < 4; ++k) {
+            cv::min(inner.mul(norms[k]), 0.2, truncated);
+            feature += truncated;
+            // texture: sum over the signed orientations of each normalization
+            if(texture)
+                features[n_signed + n_unsigned + k] += truncated;
+        }
+        feature *= 0.5;
+    };
+    for(size_t b = 0; b < n_signed; ++b)
+        contrast(signed_hists[b], features[b], true);
+    for(size_t b = 0; b < n_unsigned; ++b)
+        contrast(unsigned_hists[b], features[n_signed + b], false);
+    for(size_t k = n_signed + n_unsigned; k < features.size(); ++k)
+        features[k] *= 0.2357;
+    return features;
+}
+
 const cv::Mat HOG::get_vector_mask(const int thickness) {
     cv::Mat vector_mask = cv::Mat::zeros(mag.size(), CV_8U);
     
@@ -343,12 +1264,17 @@ const cv::Mat HOG::get_vector_mask(const int thickness) {
 }
 
 void HOG::clear_internals() {
-    for(auto& h1:_cell_hists) {
-        for(auto& h2:h1) 
-            h2.clear();
-        h1.clear();
-    }
-    _cell_hists.clear();
+    // the cell histograms are kept allocated, the next process() overwrites them
+    // and reuses their memory. The gradients are released because they may be
+    // shared with other objects (HOGBank, get_magnitudes()...)
+    mag.release();
+    ori.release();
+    _cell_valid.clear();
+    _n_valid_cells = 0;
+    _row_once.reset();
+    _img.release();
+    _energy_integral.release();
+    _norm_integral.release();
 }
 
 void HOG::save(const std::string& filename) {
@@ -28,13 +28,24 @@
     DEALINGS IN THE SOFTWARE.
     ==========================================================================================
 */
+#ifndef HOG_HPP
+#define HOG_HPP
+
+#include "Executor.hpp"
+#include "CancellationToken.hpp"
 #include "opencv2/imgproc/imgproc.hpp"
 #include "opencv2/highgui/highgui.hpp"
 #include <iostream>
 #include <algorithm>
 #include <memory>
 #include <vector>
+#include <iterator>
+#include <cstddef>
 #include <functional>
+#include <string>
+#include <stdexcept>
+#include <utility>
+#include <mutex>
 #include <math.h>
 
 class HOG {
@@ -46,6 +57,17 @@ public:
     static const size_t GRADIENT_UNSIGNED = 180;
     static constexpr TType epsilon = 1e-6;
     enum class BLOCK_NORM {none, L1norm, L1sqrt, L2norm, L2hys};
+    
+    /// Memory layout of the HOG written by HOG::retrieve()
+    struct Layout {
+        /// block_major: blocks one after the other, each made of its cells (row-major), each made of its bins
+        ///              (the layout of HOG::retrieve() without layout).
+        /// channels_first: one plane per bin, each made of the blocks, each made of its cells.
+        enum class ORDER {block_major, channels_first};
+        ORDER order = ORDER::block_major;
+        size_t padding = 1;     ///< the stride of a block (block_major) or of a plane (channels_first) is a multiple of this number of elements, the padding is zero
+        size_t alignment = 0;   ///< required alignment of the output in bytes (0 for none)
+    };
 
     // see: https://en.wikipedia.org/wiki/Histogram_of_oriented_gradients#Block_normalization
     static void L1norm(THist& v);
@@ -75,6 +97,19 @@ private:
 
     cv::Mat mag, ori;
     std::vector<std::vector<THist>> _cell_hists;
+    std::vector<unsigned char> _cell_valid; ///< cell-validity bitmap (1 if the cell histogram has been computed)
+    size_t _n_valid_cells = 0;
+    
+    bool _lazy = false; ///< if true, process() only records the image and retrieve() computes the cells it needs
+    cv::Mat _img; ///< image recorded by process() in lazy mode
+    std::unique_ptr<std::once_flag[]> _row_once; ///< one flag per cell-row, set when the row has been computed
+    
+    bool _energy_map = false; ///< if true, process() builds the integral image of the cell energies
+    bool _rotation_normalization = false; ///< if true, retrieve() turns the window to its dominant orientation
+    cv::Mat _energy_integral; ///< summed-area table of the cell energies (CV_64F, one more row and column than the cells)
+    cv::Mat _norm_integral; ///< summed-area table of the squared norms of the cells (L2norm and L2hys only)
+    
+    std::shared_ptr<Executor> _executor; ///< runs the parallel loops (Executor::default_executor() if null)
 
 public:
     HOG();
@@ -101,11 +136,227 @@ public:
     /// @return none
     void process(const cv::Mat& img);
     
+    /// Same as HOG::process() but can be cancelled and reports its progress.
+    /// The token and the progress are checked after each band of cell-rows. 
+    /// The callback may be called from the worker threads (one call at a time).
+    ///
+    /// @param img: source image (any size)
+    /// @param token: token to cancel the processing from another thread
+    /// @param progress: callback receiving the progress (can be null)
+    /// @return none, throws OperationCancelled if cancelled
+    void process(const cv::Mat& img, const CancellationToken& token, const ProgressCallback& progress = nullptr);
+    
+    /// Processes a batch of images, each one in its own HOG object having the 
+    /// parameters of this one. The work is split in tasks of similar cost (bands 
+    /// of the big images, whole small images) run by the work-stealing executor,
+    /// so that images of very different sizes keep all the threads busy.
+    /// The images are always processed eagerly (no lazy mode).
+    ///
+    /// @param images: source images (any size)
+    /// @param hogs: ref. to the vector where to store one processed HOG per image
+    ///              (the objects already in the vector are reused)
+    /// @return none
+    void process_batch(const std::vector<cv::Mat>& images, std::vector<HOG>& hogs) const;
+    
+    /// Same as HOG::process_batch() but can be cancelled and reports its progress
+    /// (see HOG::process()). The progress is weighted by the number of pixels.
+    ///
+    /// @param images: source images (any size)
+    /// @param hogs: ref. to the vector where to store one processed HOG per image
+    /// @param token: token to cancel the processing from another thread
+    /// @param progress: callback receiving the progress (can be null)
+    /// @return none, throws OperationCancelled if cancelled
+    void process_batch(const std::vector<cv::Mat>& images, std::vector<HOG>& hogs, 
+                       const CancellationToken& token, const ProgressCallback& progress = nullptr) const;
+    
+    /// Enables/disables the lazy mode. In lazy mode process() only records the image
+    /// and the cells are computed row by row the first time HOG::retrieve() needs them.
+    /// Concurrent calls to HOG::retrieve() are safe, each cell-row is computed once.
+    /// The image must not be modified until the next call to process().
+    ///
+    /// @param lazy: true to enable the lazy mode
+    /// @return none
+    void set_lazy(const bool lazy);
+    
+    /// Enables/disables the energy map. When enabled, process() also builds an 
+    /// integral image of the gradient energy of the cells (a by-product of the 
+    /// binning), so that the energy of any window can be queried in O(1) to skip
+    /// flat windows before calling HOG::retrieve(). Not available in lazy mode.
+    ///
+    /// @param enable: true to build the energy map
+    /// @return none
+    void set_energy_map(const bool enable);
+    
+    /// Energy of a window: sum of the gradient magnitudes of its cells. Throws, as
+    /// HOG::retrieve(), if the window goes outside of the processed area (ROI mode).
+    ///
+    /// @param window: image's ROI/widnow in pixels
+    /// @return the energy of the window
+    TType window_energy(const cv::Rect& window) const;
+    
+    /// Enumerates the sliding windows whose energy is above a threshold, among the
+    /// windows inside the processed area (ROI mode)
+    ///
+    /// @param window: size of the windows in pixels
+    /// @param stride: step between two windows in pixels (multiple of cellsize)
+    /// @param min_energy: minimum energy of a window (see HOG::window_energy())
+    /// @return the windows with enough energy
+    std::vector<cv::Rect> windows_above_energy(const cv::Size& window, const size_t stride, const TType min_energy) const;
+    
+    /// Enables/disables the rotation normalization of the HOG of the windows (HOG::retrieve(),
+    /// HOG::retrieve_many(), HOG::retrieve_resampled(), HOG::windows(); HOG::retrieve_block()
+    /// and HOG::get_block_map(), hence MultiModelDetector::detect(), throw). The dominant orientation of the window is estimated from the sum of its
+    /// cell histograms, the bins of every cell are circularly shifted so that it becomes
+    /// the first bin, and the grid of cells is turned by the closest multiple of 90° (only
+    /// 180° for windows that aren't square, at most 90° for unsigned gradients). The grid
+    /// is turned only if 90° (180°) is a whole number of bins, e.g. not for 9 signed bins
+    /// of 40°, otherwise the turned grid would not match the shifted bins.
+    /// No pixel is touched: the cost is a permutation of the cells.
+    ///
+    /// @param enable: true to normalize the rotation
+    /// @return none
+    void set_rotation_normalization(const bool enable);
+    
+    /// Sets the executor running the parallel loops of the library. By default 
+    /// a work-stealing pool shared by the whole process is used. An application 
+    /// with its own thread pool (or TBB arena) can inject it with a CallbackExecutor 
+    /// so that the library doesn't spawn more threads than cores.
+    ///
+    /// @param executor: the executor (null for the default one)
+    /// @return none
+    void set_executor(const std::shared_ptr<Executor>& executor);
+    
+    /// Extracts the histograms of gradients only for the cells covered by a set of ROIs.
+    /// Gradients and cell histograms are computed for the union of the cells
+    /// covered by the ROIs, the rest of the image is skipped. HOG::retrieve() can
+    /// then be used on windows that lie inside the processed cells.
+    ///
+    /// @param img: source image (any size)
+    /// @param rois: image's ROIs in pixels
+    /// @return none
+    void process(const cv::Mat& img, const std::vector<cv::Rect>& rois);
+    
+    /// Same as HOG::process(img, rois) but can be cancelled and reports its progress
+    /// (see HOG::process()). The token and the progress are checked after each row of cells.
+    ///
+    /// @param img: source image (any size)
+    /// @param rois: image's ROIs in pixels
+    /// @param token: token to cancel the processing from another thread
+    /// @param progress: callback receiving the progress (can be null)
+    /// @return none, throws OperationCancelled if cancelled
+    void process(const cv::Mat& img, const std::vector<cv::Rect>& rois, 
+                 const CancellationToken& token, const ProgressCallback& progress = nullptr);
+    
+    /// Updates the cell histograms after a local change of the image.
+    /// Gradients are recomputed only inside the dirty region plus a one-pixel halo
+    /// and only the cells touched by it are rebinned, the rest is left intact.
+    /// The blocks are normalized by HOG::retrieve() so only those containing the
+    /// updated cells change. Cells not processed yet (ROI or lazy mode) are skipped.
+    ///
+    /// @param img: the modified image (same size as the processed one)
+    /// @param dirty: region of the image that has changed, in pixels
+    /// @return none
+    void update(const cv::Mat& img, const cv::Rect& dirty);
+    
+    /// Updates the cell histograms after local changes of the image (see above)
+    ///
+    /// @param img: the modified image (same size as the processed one)
+    /// @param dirty: regions of the image that have changed, in pixels
+    /// @return none
+    void update(const cv::Mat& img, const std::vector<cv::Rect>& dirty);
+    
+    /// Same as HOG::update(img, dirty) but can be cancelled and reports its progress.
+    /// The token and the progress are checked after each region and each row of 
+    /// rebinned cells. A cancelled update leaves the cells out of date with the image,
+    /// so the internals are cleared as by a cancelled HOG::process().
+    ///
+    /// @param img: the modified image (same size as the processed one)
+    /// @param dirty: regions of the image that have changed, in pixels
+    /// @param token: token to cancel the update from another thread
+    /// @param progress: callback receiving the progress (can be null)
+    /// @return none, throws OperationCancelled if cancelled
+    void update(const cv::Mat& img, const std::vector<cv::Rect>& dirty, 
+                const CancellationToken& token, const ProgressCallback& progress = nullptr);
+    
     /// Retrieves the HOG from an image's ROI
     ///
     /// @param window: image's ROI/widnow in pixels
     /// @return the HOG histogram as std::vector
     const THist retrieve(const cv::Rect& window);
+    
+    /// Retrieves the HOG from an image's ROI into an existing vector, whose
+    /// capacity is reused (no allocation when retrieving windows of the same size)
+    ///
+    /// @param window: image's ROI/widnow in pixels
+    /// @param out: where to store the HOG (resized)
+    /// @return none
+    void retrieve(const cv::Rect& window, THist& out);
+    
+    class WindowRange;
+    
+    /// Lazy range over the sliding windows of the processed image, row by row.
+    /// Dereferencing an iterator retrieves the HOG of its window (see HOG::WindowRange),
+    /// so the descriptors of all the windows are never held in memory at once.
+    ///
+    /// @param window: size of the windows in pixels
+    /// @param stride: step between two windows in pixels (multiple of cellsize)
+    /// @return the range of the windows, the last column and row of windows included
+    WindowRange windows(const cv::Size& window, const size_t stride);
+    
+    /// Retrieves a HOG of fixed length from a window of any size. The cells of the
+    /// window are resampled to a grid of out_cells_y x out_cells_x cells, each output
+    /// cell being the area-weighted mean of the cells it covers, then the blocks 
+    /// of the grid are normalized. The result has the size of the HOG of a window
+    /// of out_cells_y x out_cells_x cells, so one HOG::process() serves windows of
+    /// every size.
+    ///
+    /// @param window: image's ROI/widnow in pixels
+    /// @param out_cells_y: number of rows of cells of the output grid
+    /// @param out_cells_x: number of columns of cells of the output grid
+    /// @return the HOG histogram as std::vector
+    const THist retrieve_resampled(const cv::Rect& window, const size_t out_cells_y, const size_t out_cells_x);
+    
+    /// Retrieves the HOG from an image's ROI in a given memory layout, e.g. with the 
+    /// blocks padded to 8 or 16 elements for aligned SIMD dot products, or with
+    /// the bins first.
+    ///
+    /// @param window: image's ROI/widnow in pixels
+    /// @param layout: memory layout of the output
+    /// @param out: where to write the HOG, HOG::descriptor_size(window, layout) elements
+    ///             aligned to layout.alignment bytes
+    /// @return none
+    void retrieve(const cv::Rect& window, const Layout& layout, TType* out);
+    
+    /// Retrieves the HOG from an image's ROI in a given memory layout (see above).
+    /// Throws if the layout asks for an alignment larger than the one of TType, which
+    /// a std::vector can't guarantee: use the overload with a pointer to aligned memory.
+    ///
+    /// @param window: image's ROI/widnow in pixels
+    /// @param layout: memory layout of the output
+    /// @param out: where to store the HOG (resized)
+    /// @return none
+    void retrieve(const cv::Rect& window, const Layout& layout, THist& out);
+    
+    /// Retrieves the HOG of many image's ROIs at once. The distinct blocks needed 
+    /// by the ROIs are normalized once and in parallel, then the histograms are 
+    /// assembled visiting the ROIs in Morton order of their origin. Much faster 
+    /// than HOG::retrieve() for lists of overlapping proposals.
+    ///
+    /// @param windows: image's ROIs/widnows in pixels
+    /// @return the HOG histograms, in the same order as the windows
+    const std::vector<THist> retrieve_many(const std::vector<cv::Rect>& windows);
+    
+    /// Retrieves a single normalized block of a window. The blocks are indexed
+    /// in the same order as they appear in HOG::retrieve(), block k occupying the
+    /// elements [k*get_block_hist_size(), (k+1)*get_block_hist_size()) of the HOG.
+    /// Useful to evaluate a model block by block and stop early. Not available with
+    /// the rotation normalization, which depends on the whole window.
+    ///
+    /// @param window: image's ROI/widnow in pixels
+    /// @param block: index of the block in the window
+    /// @param block_hist: where to store the block (its capacity is reused)
+    /// @return none
+    void retrieve_block(const cv::Rect& window, const size_t block, THist& block_hist);
 
 private:
     /// Retrieves magnitude and orientation form an image
@@ -115,13 +366,105 @@ private:
     /// @param pri: ref. to the orientation matrix where to store the result
     /// @return none
     void magnitude_and_orientation(const cv::Mat& img);
+    
+    /// Computes magnitude and orientation only inside a region of the image.
+    /// The pixels around the region are used as border so that the result
+    /// is the same as if the whole image was processed.
+    ///
+    /// @param img: source image (any size)
+    /// @param rect: region of the image in pixels
+    /// @return none
+    void magnitude_and_orientation(const cv::Mat& img, const cv::Rect& rect);
+    
+    /// Checks a window and converts it to cell units, computing its cells in lazy mode
+    ///
+    /// @param window: image's ROI/widnow in pixels
+    /// @param caller: name of the calling function for the error messages
+    /// @return the window in cell units
+    cv::Rect window_cells(const cv::Rect& window, const std::string& caller);
+    
+    /// Checks that all the cells of a region have been computed
+    ///
+    /// @param cells: region in cell units
+    /// @return true if all the cells are valid
+    bool cells_valid(const cv::Rect& cells) const;
+    
+    /// Retrieves the HOG of a window turned to its dominant orientation
+    /// (see HOG::set_rotation_normalization())
+    ///
+    /// @param cells: the window in cell units
+    /// @return the HOG histogram as std::vector
+    const THist retrieve_rotated(const cv::Rect& cells) const;
+    
+    /// Turns a grid of cell histograms to its dominant orientation
+    /// (see HOG::set_rotation_normalization())
+    ///
+    /// @param grid: the cell histograms, row by row
+    /// @param height: number of rows of cells of the grid
+    /// @param width: number of columns of cells of the grid
+    /// @return the turned grid, with the bins shifted
+    std::vector<THist> rotate_grid(const std::vector<THist>& grid, const size_t height, const size_t width) const;
+    
+    /// Normalizes the blocks of a grid of cell histograms
+    ///
+    /// @param grid: the cell histograms, row by row
+    /// @param height: number of rows of cells of the grid
+    /// @param width: number of columns of cells of the grid
+    /// @return the HOG of the grid, the blocks in the same order as HOG::retrieve()
+    const THist grid_blocks(const std::vector<THist>& grid, const size_t height, const size_t width) const;
+    
+    /// Concatenates the cells of a block and normalizes it. With L2norm and L2hys
+    /// the norm of the block comes from the summed-area table of the cell norms
+    /// when available (not in lazy mode).
+    ///
+    /// @param block_y: row of the top-left cell of the block
+    /// @param block_x: column of the top-left cell of the block
+    /// @param block_hist: where to store the block
+    /// @return none
+    void build_block(const size_t block_y, const size_t block_x, THist& block_hist) const;
+    
+    /// Allocates the internal data for a new image (eager mode)
+    ///
+    /// @param img: source image
+    /// @return none
+    void prepare(const cv::Mat& img);
+    
+    /// Computes gradients and cell histograms of a band of cell-rows
+    ///
+    /// @param img: source image
+    /// @param begin: first row of cells
+    /// @param end: one past the last row of cells
+    /// @return none
+    void process_rows(const cv::Mat& img, const size_t begin, const size_t end);
+    
+    /// Computes gradients and cell histograms of one row of cells (lazy mode)
+    ///
+    /// @param cell_y: index of the row of cells
+    /// @return none
+    void process_row(const size_t cell_y);
 
-    /// Iterates over a cell to create the cell histogram
+    /// Creates the histograms of a horizontal run of cells from the magnitude and
+    /// orientation matrices. The bins of each row of pixels of the run are computed
+    /// at once, then the magnitudes are accumulated cell by cell.
+    ///
+    /// @param cell_y: row of the cells
+    /// @param cell_begin: first cell of the run
+    /// @param cell_end: one past the last cell of the run
+    /// @return none
+    void process_cells(const size_t cell_y, const size_t cell_begin, const size_t cell_end);
+    
+    /// Builds the data derived from the cell histograms (energy map, norms of the cells)
+    /// at the end of the processing. After an update only the entries of the summed-area
+    /// tables below and on the right of the first changed cell are recomputed.
+    ///
+    /// @param first: first changed cell (row and column), (0,0) to build everything
+    /// @return none
+    void finalize(const cv::Point& first = cv::Point(0, 0));
+    
+    /// Executor running the parallel loops
     ///
-    /// @param cell_mag: a portion of a block (cell) of the magnitude matrix
-    /// @param cell_ori: a portion of a block (cell) of the orientation matrix
-    /// @return the cell histogram as std::vector
-    const THist process_cell(const cv::Mat& cell_mag, const cv::Mat& cell_ori);
+    /// @return the executor set or the default one
+    Executor& executor() const;
     
     /// Clear internal/local data
     ///
@@ -130,6 +473,34 @@ private:
     void clear_internals();
 
 public:
+    /// Utility funtions to retreve the parameters of the HOG
+    size_t get_blocksize() const { return _blocksize; }
+    size_t get_cellsize() const { return _cellsize; }
+    size_t get_stride() const { return _stride; }
+    size_t get_binning() const { return _binning; }
+    size_t get_grad_type() const { return _grad_type; }
+    BLOCK_NORM get_norm_function() const { return _norm_function; }
+    size_t get_block_hist_size() const { return _block_hist_size; }
+
+    /// Utility funtion to compute the size of the HOG of a window in a memory layout
+    ///
+    /// @param window: size of the window in pixels
+    /// @param layout: memory layout (see HOG::Layout)
+    /// @return the number of elements written by HOG::retrieve() with the layout
+    size_t descriptor_size(const cv::Size& window, const Layout& layout) const;
+
+    /// Utility funtion to compute the number of blocks in a window
+    ///
+    /// @param window: size of the window in pixels
+    /// @return the number of blocks of the HOG of the window
+    size_t n_blocks(const cv::Size& window) const;
+
+    /// Utility funtion to compute the size of the HOG of a window
+    ///
+    /// @param window: size of the window in pixels
+    /// @return the number of elements returned by HOG::retrieve()
+    size_t descriptor_size(const cv::Size& window) const;
+
     /// Utility funtion to retreve the magnitude matrix
     ///
     /// @return the magnitude matrix CV_32F
@@ -140,6 +511,32 @@ public:
     /// @return the orientation matrix CV_32F
     const cv::Mat get_orientations();
 
+    /// Utility funtion to retreve the cell histograms as a multi-channel map
+    /// (e.g. for the correlation with a template, see HOGCorrelator).
+    /// In lazy mode all the cells are computed.
+    ///
+    /// @return one CV_32F matrix of n_cells_y x n_cells_x per bin
+    const std::vector<cv::Mat> get_cell_map();
+
+    /// Utility funtion to retreve all the normalized blocks of the image, one block
+    /// at every cell position (whatever the stride), so that the blocks shared by
+    /// many windows are normalized once. The block whose top-left cell is (y, x) is 
+    /// the row y*(n_cells_x-n_cells_per_block_x+1) + x. In lazy mode all the cells are computed.
+    /// Throws with the rotation normalization, which depends on the whole window.
+    ///
+    /// @return CV_32F matrix with one block per row
+    const cv::Mat get_block_map();
+
+    /// Felzenszwalb's 31-dimensional cell features (FHOG) computed from the 
+    /// gradients of the last processed image, whatever the binning of the object:
+    /// 18 signed orientations, 9 unsigned orientations and 4 texture features,
+    /// each cell being normalized by the energy of its 4 neighbouring 2x2 blocks 
+    /// and truncated at 0.2. The cells of the border have no full neighbourhood 
+    /// and are left out. In lazy mode all the cells are computed.
+    ///
+    /// @return 31 CV_32F matrices of (n_cells_y-2) x (n_cells_x-2)
+    const std::vector<cv::Mat> get_fhog();
+
     /// Utility funtion to retreve a mask of vectors
     ///
     /// @return the vector matrix CV_32F
@@ -154,4 +551,156 @@ public:
     /// @param filename: name of the file where to retrieve the object
     /// @return HOG object
     static HOG load(const std::string& filename);
+
+    friend class HOGBank;
+};
+
+/// Range of sliding windows returned by HOG::windows(). The iterators are input
+/// iterators yielding (rect, descriptor) windows: the HOG is retrieved on the first
+/// dereference in a buffer owned by the iterator and reused after each increment, so
+/// the descriptors are never held all at once. A window is reached directly with
+/// WindowRange::rect() and WindowRange::at(). The parallel iteration goes through the
+/// range, which is splittable (TBB Range concept, e.g. tbb::parallel_for).
+class HOG::WindowRange {
+public:
+    struct Window {
+        cv::Rect rect; ///< the window in pixels
+        THist descriptor; ///< HOG of the window
+    };
+    
+    class iterator {
+    private:
+        HOG* _hog = nullptr;
+        cv::Size _window;
+        size_t _stride = 0;
+        size_t _n_windows_x = 0;
+        size_t _index = 0;
+        mutable Window _value; ///< window of _index, retrieved on the first dereference
+        mutable bool _retrieved = false;
+        
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = Window;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Window*;
+        using reference = const Window&;
+        
+        /// Result of the postfix increment: takes the window of the previous position
+        /// (retrieved only if dereferenced) without copying the descriptor
+        class postfix {
+        private:
+            HOG* _hog;
+            mutable Window _value;
+            mutable bool _retrieved;
+        public:
+            postfix(HOG* hog, Window&& value, const bool retrieved) : _hog(hog), _value(std::move(value)), _retrieved(retrieved) {}
+            const Window& operator*() const {
+                if(!_retrieved) {
+                    _hog->retrieve(_value.rect, _value.descriptor);
+                    _retrieved = true;
+                }
+                return _value;
+            }
+        };
+        
+        iterator() = default;
+        iterator(HOG* hog, const cv::Size& window, const size_t stride, const size_t n_windows_x, const size_t index)
+            : _hog(hog), _window(window), _stride(stride), _n_windows_x(n_windows_x), _index(index) {}
+        
+        /// The window pointed by the iterator, without retrieving its HOG
+        cv::Rect rect() const {
+            return cv::Rect(static_cast<int>((_index%_n_windows_x)*_stride), 
+                            static_cast<int>((_index/_n_windows_x)*_stride), _window.width, _window.height);
+        }
+        
+        /// The window and its HOG, valid until the iterator is incremented or destroyed
+        reference operator*() const {
+            if(!_retrieved) {
+                _value.rect = rect();
+                _hog->retrieve(_value.rect, _value.descriptor);
+                _retrieved = true;
+            }
+            return _value;
+        }
+        pointer operator->() const { return &**this; }
+        
+        iterator& operator++() { ++_index; _retrieved = false; return *this; }
+        postfix operator++(int) {
+            const bool retrieved = _retrieved;
+            _value.rect = rect();
+            postfix previous(_hog, std::move(_value), retrieved);
+            ++*this;
+            return previous;
+        }
+        friend bool operator==(const iterator& a, const iterator& b) { return a._index == b._index; }
+        friend bool operator!=(const iterator& a, const iterator& b) { return a._index != b._index; }
+    };
+    
+private:
+    HOG* _hog;
+    cv::Size _window;
+    size_t _stride;
+    size_t _n_windows_x;
+    size_t _n_windows_y;
+    size_t _begin; ///< index of the first window of the range (row major)
+    size_t _end; ///< index one past the last window of the range
+    size_t _grain = 1; ///< the range is not split below this number of windows
+    
+public:
+    WindowRange(HOG* hog, const cv::Size& window, const size_t stride, const size_t n_windows_x, const size_t n_windows_y)
+        : _hog(hog), _window(window), _stride(stride), _n_windows_x(n_windows_x), _n_windows_y(n_windows_y), 
+          _begin(0), _end(n_windows_x*n_windows_y) {}
+    
+    /// Splitting constructor (TBB Range concept, e.g. with tbb::split): r keeps 
+    /// the first half of its windows, the new range takes the second half
+    template<typename Split>
+    WindowRange(WindowRange& r, Split) : WindowRange(r) {
+        _begin = r._begin + (r._end - r._begin)/2;
+        r._end = _begin;
+    }
+    
+    iterator begin() const { return iterator(_hog, _window, _stride, _n_windows_x, _begin); }
+    iterator end() const { return iterator(_hog, _window, _stride, _n_windows_x, _end); }
+    size_t size() const { return _end - _begin; }
+    
+    /// The i-th window of the range, without retrieving its HOG
+    ///
+    /// @param i: index of the window in the range (row major)
+    /// @return the window in pixels
+    cv::Rect rect(const size_t i) const {
+        if(i >= size())
+            throw std::runtime_error("HOG::WindowRange::rect(): index out of range!");
+        return iterator(_hog, _window, _stride, _n_windows_x, _begin + i).rect();
+    }
+    
+    /// The i-th window of the range and its HOG
+    ///
+    /// @param i: index of the window in the range (row major)
+    /// @return the window and its HOG
+    Window at(const size_t i) const {
+        Window w;
+        w.rect = rect(i);
+        _hog->retrieve(w.rect, w.descriptor);
+        return w;
+    }
+    bool empty() const { return _begin == _end; }
+    bool is_divisible() const { return size() > _grain; }
+    
+    /// Number of windows along the columns and the rows of the whole image
+    size_t n_windows_x() const { return _n_windows_x; }
+    size_t n_windows_y() const { return _n_windows_y; }
+    
+    /// Sets the minimum number of windows of a split range
+    ///
+    /// @param grain: the minimum number of windows (at least 1)
+    /// @return the range itself
+    WindowRange& set_grain(const size_t grain) { _grain = grain > 0 ? grain : 1; return *this; }
 };
+
+/// Block normalization function of a HOG::BLOCK_NORM
+///
+/// @param norm: the normalization
+/// @return the function normalizing a block in place
+std::function<void(HOG::THist&)> get_block_norm(const HOG::BLOCK_NORM norm);
+
+#endif
@@ -0,0 +1,158 @@
+/*  ==========================================================================================
+    Author: Leonardo Citraro
+    Company:
+    Filename: HOGBank.cpp
+    Last modifed:   17.10.2026 by Leonardo Citraro
+    Description:    Bank of HOG extractors sharing a single gradient pass.
+
+    ==========================================================================================
+    Copyright (c) 2016 Leonardo Citraro <ldo.citraro@gmail.com>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this
+    software and associated documentation files (the "Software"), to deal in the Software
+    without restriction, including without limitation the rights to use, copy, modify,
+    merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+    permit persons to whom the Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be included in all copies
+    or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+    INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+    PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+    FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+    OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+    ==========================================================================================
+*/
+#include "HOGBank.hpp"
+#include "HOG.hpp"
+#include "HOGKernels.hpp"
+#include "opencv2/imgproc/imgproc.hpp"
+#include <algorithm>
+#include <vector>
+#include <mutex>
+
+HOGBank::HOGBank() {}
+HOGBank::HOGBank(const std::vector<HOG>& hogs) : _hogs(hogs) {}
+HOGBank::~HOGBank() {}
+
+size_t HOGBank::add(const HOG& hog) {
+    _hogs.push_back(hog);
+    return _hogs.size() - 1;
+}
+
+void HOGBank::process(const cv::Mat& img) {
+    process(img, CancellationToken());
+}
+
+void HOGBank::process(const cv::Mat& img, const CancellationToken& token, const ProgressCallback& progress) {
+
+    if(!img.data)
+        throw std::runtime_error("HOGBank::process(): invalid image!");
+    if(_hogs.empty())
+        throw std::runtime_error("HOGBank::process(): the bank is empty!");
+    for(const auto& hog : _hogs) {
+        if(img.rows < hog._blocksize || img.cols < hog._blocksize)
+            throw std::runtime_error("HOGBank::process(): the image is smaller than blocksize!");
+    }
+
+    // cleanup
+    for(auto& hog : _hogs)
+        hog.clear_internals();
+
+    // the gradients are computed once and then shared (same cv::Mat data) by all the configurations
+    _hogs[0].magnitude_and_orientation(img);
+    const cv::Mat mag = _hogs[0].mag;
+    const cv::Mat ori = _hogs[0].ori;
+
+    std::vector<std::vector<size_t>> col_to_cell(_hogs.size());
+    for(size_t k = 0; k < _hogs.size(); ++k) {
+        HOG& hog = _hogs[k];
+        hog.mag = mag;
+        hog.ori = ori;
+        hog._n_cells_y = static_cast<int>(mag.rows/hog._cellsize);
+        hog._n_cells_x = static_cast<int>(mag.cols/hog._cellsize);
+        hog._cell_hists.assign(hog._n_cells_y, std::vector<HOG::THist>(hog._n_cells_x, HOG::THist(hog._binning, 0)));
+        hog._cell_valid.assign(hog._n_cells_y*hog._n_cells_x, 1);
+        hog._n_valid_cells = hog._cell_valid.size();
+        
+        // lookup table column -> cell, so that the inner loop doesn't divide for each configuration
+        col_to_cell[k].resize(hog._n_cells_x*hog._cellsize);
+        for(size_t j = 0; j < col_to_cell[k].size(); ++j)
+            col_to_cell[k][j] = j/hog._cellsize;
+    }
+
+    // Single sweep over the pixels: each row of magnitude/orientation is read once and
+    // binned into the cell grids of all the configurations. The bins of a row are computed
+    // at once by the kernels (vectorized), which fold the unsigned orientation on [0,180).
+    // The rows are split in bands whose height is a multiple of all the cellsizes, 
+    // so that the bands processed in parallel never share a cell.
+    size_t band = 1;
+    for(const auto& hog : _hogs) {
+        size_t a = band, b = hog._cellsize;
+        while(b != 0) { size_t t = a % b; a = b; b = t; }
+        band = band/a*hog._cellsize;
+    }
+    const size_t n_bands = (mag.rows + band - 1)/band;
+    Executor& exec = _executor ? *_executor : *Executor::default_executor();
+    const size_t grain = std::max<size_t>(1, n_bands/(4*exec.concurrency()));
+    std::mutex progress_mutex;
+    size_t n_bands_done = 0;
+    const HOGKernels& kernels = hog_kernels();
+    exec.parallel_for(0, n_bands, grain, [&](const size_t begin, const size_t end) {
+        if(token.is_cancelled())
+            return;
+        std::vector<int> bins(ori.cols);
+        for(size_t i = begin*band; i < std::min<size_t>(end*band, mag.rows); ++i) {
+            const HOG::TType* ptr_row_mag = mag.ptr<HOG::TType>(i);
+            const HOG::TType* ptr_row_ori = ori.ptr<HOG::TType>(i);
+            
+            for(size_t k = 0; k < _hogs.size(); ++k) {
+                HOG& hog = _hogs[k];
+                const size_t cell_y = i/hog._cellsize;
+                if(cell_y >= hog._n_cells_y)
+                    continue;
+                
+                std::vector<HOG::THist>& cell_row = hog._cell_hists[cell_y];
+                const HOG::TType fold = hog._grad_type == HOG::GRADIENT_SIGNED ? 360 : 180;
+                const std::vector<size_t>& cells = col_to_cell[k];
+                kernels.bin_indices(ptr_row_ori, bins.data(), cells.size(), hog._bin_width, fold, hog._binning-1);
+                for(size_t j = 0; j < cells.size(); ++j)
+                    cell_row[cells[j]][bins[j]] += ptr_row_mag[j];
+            }
+        }
+        if(progress) {
+            std::lock_guard<std::mutex> lock(progress_mutex);
+            n_bands_done += end - begin;
+            progress(static_cast<float>(n_bands_done)/n_bands);
+        }
+    });
+    
+    if(token.is_cancelled()) {
+        for(auto& hog : _hogs)
+            hog.clear_internals();
+        throw OperationCancelled("HOGBank::process(): cancelled!");
+    }
+    for(auto& hog : _hogs)
+        hog.finalize();
+}
+
+void HOGBank::set_executor(const std::shared_ptr<Executor>& executor) {
+    _executor = executor;
+}
+
+const HOG::THist HOGBank::retrieve(const size_t index, const cv::Rect& window) {
+    return (*this)[index].retrieve(window);
+}
+
+HOG& HOGBank::operator[](const size_t index) {
+    if(index >= _hogs.size())
+        throw std::runtime_error("HOGBank::operator[](): index out of range!");
+    return _hogs[index];
+}
+
+size_t HOGBank::size() const {
+    return _hogs.size();
+}
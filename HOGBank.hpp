@@ -0,0 +1,98 @@
+/*  ==========================================================================================
+    Author: Leonardo Citraro
+    Company:
+    Filename: HOGBank.hpp
+    Last modifed:   17.10.2026 by Leonardo Citraro
+    Description:    Bank of HOG extractors sharing a single gradient pass.
+                    Several HOG configurations (cellsize, binning, signed/unsigned...)
+                    are computed on the same image by sweeping the pixels once.
+
+    ==========================================================================================
+    Copyright (c) 2016 Leonardo Citraro <ldo.citraro@gmail.com>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this
+    software and associated documentation files (the "Software"), to deal in the Software
+    without restriction, including without limitation the rights to use, copy, modify,
+    merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+    permit persons to whom the Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be included in all copies
+    or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+    INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+    PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+    FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+    OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+    ==========================================================================================
+*/
+#ifndef HOGBANK_HPP
+#define HOGBANK_HPP
+
+#include "HOG.hpp"
+#include "opencv2/imgproc/imgproc.hpp"
+#include <memory>
+#include <vector>
+
+class HOGBank {
+private:
+    std::vector<HOG> _hogs; ///< one HOG extractor for each configuration
+    std::shared_ptr<Executor> _executor; ///< runs the parallel loops (Executor::default_executor() if null)
+
+public:
+    HOGBank();
+    HOGBank(const std::vector<HOG>& hogs);
+    ~HOGBank();
+
+    /// Adds a configuration to the bank
+    ///
+    /// @param hog: HOG object holding the configuration (its internals are not copied)
+    /// @return the index of the configuration in the bank
+    size_t add(const HOG& hog);
+
+    /// Extracts the cell histograms of every configuration in the bank.
+    /// The gradients are computed only once and all the cell grids are filled
+    /// during the same sweep over the pixels. Signed and unsigned configurations
+    /// share the same orientation, the unsigned one being a fold of the signed one.
+    ///
+    /// @param img: source image (any size)
+    /// @return none
+    void process(const cv::Mat& img);
+    
+    /// Same as HOGBank::process() but can be cancelled and reports its progress
+    /// (see HOG::process()). The token and the progress are checked after each band of rows.
+    ///
+    /// @param img: source image (any size)
+    /// @param token: token to cancel the processing from another thread
+    /// @param progress: callback receiving the progress (can be null)
+    /// @return none, throws OperationCancelled if cancelled
+    void process(const cv::Mat& img, const CancellationToken& token, const ProgressCallback& progress = nullptr);
+
+    /// Sets the executor running the parallel sweep (see HOG::set_executor())
+    ///
+    /// @param executor: the executor (null for the default one)
+    /// @return none
+    void set_executor(const std::shared_ptr<Executor>& executor);
+
+    /// Retrieves the HOG from an image's ROI using one of the configurations
+    ///
+    /// @param index: index of the configuration in the bank
+    /// @param window: image's ROI/widnow in pixels
+    /// @return the HOG histogram as std::vector
+    const HOG::THist retrieve(const size_t index, const cv::Rect& window);
+
+    /// Access to the HOG object of one configuration
+    ///
+    /// @param index: index of the configuration in the bank
+    /// @return reference to the HOG object
+    HOG& operator[](const size_t index);
+
+    /// Number of configurations in the bank
+    ///
+    /// @return the number of configurations
+    size_t size() const;
+};
+
+#endif
@@ -0,0 +1,95 @@
+/*  ==========================================================================================
+    Author: Leonardo Citraro
+    Company:
+    Filename: HOGCorrelator.cpp
+    Last modifed:   17.10.2026 by Leonardo Citraro
+    Description:    Dense correlation of a multi-channel HOG template with a map
+                    of cells (tracking, large models) computed in the Fourier domain.
+
+    ==========================================================================================
+    Copyright (c) 2016 Leonardo Citraro <ldo.citraro@gmail.com>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this
+    software and associated documentation files (the "Software"), to deal in the Software
+    without restriction, including without limitation the rights to use, copy, modify,
+    merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+    permit persons to whom the Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be included in all copies
+    or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+    INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+    PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+    FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+    OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+    ==========================================================================================
+*/
+#include "HOGCorrelator.hpp"
+#include "opencv2/core/core.hpp"
+#include <vector>
+
+HOGCorrelator::HOGCorrelator() {}
+HOGCorrelator::~HOGCorrelator() {}
+
+void HOGCorrelator::set_template(const std::vector<cv::Mat>& templ) {
+    if(templ.empty())
+        throw std::runtime_error("HOGCorrelator::set_template(): empty template!");
+    for(const auto& plane : templ) {
+        if(plane.type() != CV_32F || plane.size() != templ[0].size() || plane.empty())
+            throw std::runtime_error("HOGCorrelator::set_template(): the planes must be non-empty CV_32F of the same size!");
+    }
+    _template.resize(templ.size());
+    for(size_t c = 0; c < templ.size(); ++c)
+        templ[c].copyTo(_template[c]);
+    // the spectra are computed on the next call
+    _map_size = cv::Size();
+    _template_spectra.clear();
+}
+
+void HOGCorrelator::forward(const cv::Mat& plane, cv::Mat& spectrum) {
+    _padded.setTo(0);
+    cv::Mat roi(_padded, cv::Rect(0, 0, plane.cols, plane.rows));
+    plane.copyTo(roi);
+    cv::dft(_padded, spectrum, 0, plane.rows);
+}
+
+cv::Mat HOGCorrelator::correlate(const std::vector<cv::Mat>& map) {
+    if(_template.empty())
+        throw std::runtime_error("HOGCorrelator::correlate(): no template!");
+    if(map.size() != _template.size())
+        throw std::runtime_error("HOGCorrelator::correlate(): the map and the template have a different number of channels!");
+    const cv::Size templ_size = _template[0].size();
+    const cv::Size map_size = map[0].size();
+    for(const auto& plane : map) {
+        if(plane.type() != CV_32F || plane.size() != map_size)
+            throw std::runtime_error("HOGCorrelator::correlate(): the planes must be CV_32F of the same size!");
+    }
+    if(map_size.height < templ_size.height || map_size.width < templ_size.width)
+        throw std::runtime_error("HOGCorrelator::correlate(): the map is smaller than the template!");
+    
+    // the valid offsets never wrap around if the transforms are at least as big as the map
+    if(map_size != _map_size) {
+        _map_size = map_size;
+        _dft_size = cv::Size(cv::getOptimalDFTSize(map_size.width), cv::getOptimalDFTSize(map_size.height));
+        _padded.create(_dft_size, CV_32F);
+        _template_spectra.resize(_template.size());
+        for(size_t c = 0; c < _template.size(); ++c)
+            forward(_template[c], _template_spectra[c]);
+    }
+    
+    _sum.create(_dft_size, CV_32F);
+    _sum.setTo(0);
+    for(size_t c = 0; c < map.size(); ++c) {
+        forward(map[c], _spectrum);
+        // conjugating the template turns the convolution into a correlation
+        cv::mulSpectrums(_spectrum, _template_spectra[c], _product, 0, true);
+        _sum += _product;
+    }
+    cv::dft(_sum, _response, cv::DFT_INVERSE | cv::DFT_SCALE | cv::DFT_REAL_OUTPUT);
+    
+    const cv::Size valid(map_size.width - templ_size.width + 1, map_size.height - templ_size.height + 1);
+    return _response(cv::Rect(0, 0, valid.width, valid.height)).clone();
+}
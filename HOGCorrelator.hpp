@@ -0,0 +1,81 @@
+/*  ==========================================================================================
+    Author: Leonardo Citraro
+    Company:
+    Filename: HOGCorrelator.hpp
+    Last modifed:   17.10.2026 by Leonardo Citraro
+    Description:    Dense correlation of a multi-channel HOG template with a map
+                    of cells (tracking, large models) computed in the Fourier domain.
+
+    ==========================================================================================
+    Copyright (c) 2016 Leonardo Citraro <ldo.citraro@gmail.com>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this
+    software and associated documentation files (the "Software"), to deal in the Software
+    without restriction, including without limitation the rights to use, copy, modify,
+    merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+    permit persons to whom the Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be included in all copies
+    or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+    INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+    PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+    FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+    OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+    ==========================================================================================
+*/
+#ifndef HOGCORRELATOR_HPP
+#define HOGCORRELATOR_HPP
+
+#include "opencv2/core/core.hpp"
+#include <vector>
+
+/// Correlates a multi-channel template (e.g. HOG::get_cell_map() of a target)
+/// with a multi-channel map at every offset. Each channel is transformed with
+/// cv::dft(), the products with the conjugated spectra of the template are summed
+/// over the channels and a single inverse transform gives the response.
+/// The spectra of the template and the buffers are kept between calls with 
+/// maps of the same size.
+class HOGCorrelator {
+private:
+    std::vector<cv::Mat> _template;           ///< one plane per channel
+    cv::Size _map_size;                       ///< size of the map of the cached spectra
+    cv::Size _dft_size;                       ///< size of the transforms (optimal for cv::dft())
+    std::vector<cv::Mat> _template_spectra;   ///< spectra of the template planes for _dft_size
+    cv::Mat _padded;                          ///< buffer: plane padded to _dft_size
+    cv::Mat _spectrum;                        ///< buffer: spectrum of a plane of the map
+    cv::Mat _product;                         ///< buffer: product of two spectra
+    cv::Mat _sum;                             ///< buffer: sum of the products over the channels
+    cv::Mat _response;                        ///< buffer: inverse transform of the sum
+
+public:
+    HOGCorrelator();
+    ~HOGCorrelator();
+    
+    /// Sets the template
+    ///
+    /// @param templ: one CV_32F plane per channel, all of the same size
+    /// @return none
+    void set_template(const std::vector<cv::Mat>& templ);
+    
+    /// Correlation of the template with a map, at every offset where the template
+    /// lies entirely inside the map: 
+    ///     response(y,x) = sum_c sum_i,j map_c(y+i, x+j)*templ_c(i, j)
+    ///
+    /// @param map: one CV_32F plane per channel (as many as the template, at least as big)
+    /// @return the response, CV_32F of size (map - template + 1)
+    cv::Mat correlate(const std::vector<cv::Mat>& map);
+
+private:
+    /// Transforms a plane padded with zeros to _dft_size
+    ///
+    /// @param plane: CV_32F plane
+    /// @param spectrum: where to store the spectrum (CCS packed)
+    /// @return none
+    void forward(const cv::Mat& plane, cv::Mat& spectrum);
+};
+
+#endif
@@ -0,0 +1,363 @@
+/*  ==========================================================================================
+    Author: Leonardo Citraro
+    Company:
+    Filename: HOGDetector.cpp
+    Last modifed:   17.10.2026 by Leonardo Citraro
+    Description:    Sliding-window detectors built on top of the HOG.
+
+    ==========================================================================================
+    Copyright (c) 2016 Leonardo Citraro <ldo.citraro@gmail.com>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this
+    software and associated documentation files (the "Software"), to deal in the Software
+    without restriction, including without limitation the rights to use, copy, modify,
+    merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+    permit persons to whom the Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be included in all copies
+    or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+    INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+    PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+    FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+    OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+    ==========================================================================================
+*/
+#include "HOGDetector.hpp"
+#include "HOG.hpp"
+#include "opencv2/imgproc/imgproc.hpp"
+#include <algorithm>
+#include <numeric>
+#include <vector>
+#include <mutex>
+
+AnytimeDetector::AnytimeDetector(const HOG& hog, const cv::Size& window, const HOG::THist& weights, 
+                                 const float bias, const float threshold, const double scale_step)
+    : _hog(hog), _window(window), _weights(weights), _bias(bias), _threshold(threshold), 
+      _scale_step(scale_step), _window_stride(hog.get_cellsize()) {
+        if(window.height < hog.get_blocksize() || window.width < hog.get_blocksize())
+            throw std::runtime_error("AnytimeDetector::AnytimeDetector(): the window is smaller than blocksize!");
+        if(weights.size() != hog.descriptor_size(window))
+            throw std::runtime_error("AnytimeDetector::AnytimeDetector(): the size of the weights doesn't match the HOG of the window!");
+        if(scale_step <= 1)
+            throw std::runtime_error("AnytimeDetector::AnytimeDetector(): scale_step must be greater than 1!");
+        // the windows are ranked by energy, all the cells are needed
+        _hog.set_lazy(false);
+        _hog.set_energy_map(true);
+    }
+AnytimeDetector::~AnytimeDetector() {}
+
+void AnytimeDetector::set_window_stride(const size_t stride) {
+    if(stride == 0 || stride%_hog.get_cellsize() != 0)
+        throw std::runtime_error("AnytimeDetector::set_window_stride(): stride must be a multiple of cellsize!");
+    _window_stride = stride;
+}
+
+AnytimeDetector::Result AnytimeDetector::detect(const cv::Mat& img, const Clock::duration& budget, 
+                                                const CancellationToken& token) {
+    return detect_until(img, Clock::now() + budget, token);
+}
+
+AnytimeDetector::Result AnytimeDetector::detect_until(const cv::Mat& img, const Clock::time_point& deadline, 
+                                                      const CancellationToken& token) {
+    
+    if(!img.data)
+        throw std::runtime_error("AnytimeDetector::detect(): invalid image!");
+    
+    // the scales of the pyramid, the image is downscaled by each factor
+    std::vector<double> scales;
+    std::vector<size_t> n_windows;
+    Result result;
+    for(double s = 1; img.rows/s >= _window.height && img.cols/s >= _window.width; s *= _scale_step) {
+        const int rows = static_cast<int>(img.rows/s);
+        const int cols = static_cast<int>(img.cols/s);
+        const size_t n = ((rows - _window.height)/_window_stride + 1)*((cols - _window.width)/_window_stride + 1);
+        scales.push_back(s);
+        n_windows.push_back(n);
+        result.n_windows_total += n;
+    }
+    
+    auto stop = [&]() { 
+        return token.is_cancelled() || Clock::now() >= deadline; 
+    };
+    
+    // coarse to fine: the smallest image first
+    bool interrupted = false;
+    for(int level = static_cast<int>(scales.size())-1; level >= 0 && !interrupted; --level) {
+        if(stop()) {
+            interrupted = true;
+            break;
+        }
+        
+        const double s = scales[level];
+        cv::Mat level_img;
+        if(level == 0)
+            level_img = img;
+        else
+            cv::resize(img, level_img, cv::Size(static_cast<int>(img.cols/s), static_cast<int>(img.rows/s)), 0, 0, cv::INTER_AREA);
+        // the processing of a big scale is interrupted too when the deadline expires
+        CancellationToken level_token;
+        if(token.is_cancelled())
+            level_token.cancel();
+        try {
+            _hog.process(level_img, level_token, [&](const float) {
+                if(stop())
+                    level_token.cancel();
+            });
+        } catch(const OperationCancelled&) {
+            interrupted = true;
+            break;
+        }
+        result.n_scales_processed++;
+        
+        // the windows with the highest gradient energy are scored first
+        struct Candidate {
+            cv::Rect rect;
+            double energy;
+        };
+        std::vector<Candidate> candidates;
+        candidates.reserve(n_windows[level]);
+        for(int y = 0; y <= level_img.rows - _window.height; y += _window_stride) {
+            for(int x = 0; x <= level_img.cols - _window.width; x += _window_stride) {
+                const double e = _hog.window_energy(cv::Rect(x, y, _window.width, _window.height));
+                candidates.push_back(Candidate{cv::Rect(x, y, _window.width, _window.height), e});
+            }
+        }
+        std::sort(std::begin(candidates), std::end(candidates), [](const Candidate& a, const Candidate& b) {
+            return a.energy > b.energy;
+        });
+        
+        for(const auto& c : candidates) {
+            if(stop()) {
+                interrupted = true;
+                break;
+            }
+            const HOG::THist hist = _hog.retrieve(c.rect);
+            const float score = std::inner_product(std::begin(hist), std::end(hist), std::begin(_weights), _bias);
+            result.n_windows_evaluated++;
+            if(score > _threshold) {
+                const cv::Rect rect(static_cast<int>(c.rect.x*s), static_cast<int>(c.rect.y*s), 
+                                    static_cast<int>(c.rect.width*s), static_cast<int>(c.rect.height*s));
+                result.detections.push_back(Detection{rect, score, s});
+            }
+        }
+    }
+    
+    std::sort(std::begin(result.detections), std::end(result.detections), [](const Detection& a, const Detection& b) {
+        return a.score > b.score;
+    });
+    result.completed = !interrupted;
+    result.coverage = result.n_windows_total > 0 ? static_cast<double>(result.n_windows_evaluated)/result.n_windows_total : 1;
+    return result;
+}
+
+CascadeDetector::CascadeDetector(const HOG& hog, const cv::Size& window, const HOG::THist& weights, 
+                                 const float bias, const float threshold)
+    : _hog(hog), _window(window), _weights(weights), _bias(bias), _threshold(threshold), 
+      _window_stride(hog.get_cellsize()) {
+        if(window.height < hog.get_blocksize() || window.width < hog.get_blocksize())
+            throw std::runtime_error("CascadeDetector::CascadeDetector(): the window is smaller than blocksize!");
+        if(weights.size() != hog.descriptor_size(window))
+            throw std::runtime_error("CascadeDetector::CascadeDetector(): the size of the weights doesn't match the HOG of the window!");
+        // without stages all the blocks are scored at once
+        std::vector<size_t> all(_hog.n_blocks(window));
+        std::iota(std::begin(all), std::end(all), 0);
+        _stages.push_back(all);
+    }
+CascadeDetector::~CascadeDetector() {}
+
+void CascadeDetector::add_stage(const std::vector<size_t>& blocks, const float threshold) {
+    // the last stage holds the blocks not assigned yet
+    std::vector<size_t>& remaining = _stages.back();
+    for(const auto b : blocks) {
+        auto it = std::find(std::begin(remaining), std::end(remaining), b);
+        if(it == std::end(remaining))
+            throw std::runtime_error("CascadeDetector::add_stage(): invalid block or block already in a stage!");
+        remaining.erase(it);
+    }
+    _stages.insert(std::end(_stages)-1, blocks);
+    _stage_thresholds.push_back(threshold);
+}
+
+void CascadeDetector::set_window_stride(const size_t stride) {
+    if(stride == 0 || stride%_hog.get_cellsize() != 0)
+        throw std::runtime_error("CascadeDetector::set_window_stride(): stride must be a multiple of cellsize!");
+    _window_stride = stride;
+}
+
+void CascadeDetector::set_executor(const std::shared_ptr<Executor>& executor) {
+    _executor = executor;
+}
+
+size_t CascadeDetector::score(const cv::Rect& window, float& score) {
+    HOG::THist block_hist;
+    size_t n_blocks_normalized = 0;
+    return this->score(window, score, block_hist, n_blocks_normalized);
+}
+
+size_t CascadeDetector::score(const cv::Rect& window, float& score, HOG::THist& block_hist, size_t& n_blocks_normalized) {
+    const size_t block_hist_size = _hog.get_block_hist_size();
+    score = _bias;
+    for(size_t stage = 0; stage < _stages.size(); ++stage) {
+        for(const auto b : _stages[stage]) {
+            _hog.retrieve_block(window, b, block_hist);
+            score = std::inner_product(std::begin(block_hist), std::end(block_hist), 
+                                       std::begin(_weights) + b*block_hist_size, score);
+            ++n_blocks_normalized;
+        }
+        if(stage < _stage_thresholds.size() && score < _stage_thresholds[stage])
+            return stage;
+    }
+    return _stage_thresholds.size();
+}
+
+std::vector<Detection> CascadeDetector::detect(const cv::Mat& img) {
+    
+    if(!img.data)
+        throw std::runtime_error("CascadeDetector::detect(): invalid image!");
+    
+    _hog.process(img);
+    
+    _stats = Stats();
+    _stats.n_rejected.assign(_stage_thresholds.size(), 0);
+    std::vector<Detection> detections;
+    if(img.rows < _window.height || img.cols < _window.width)
+        return detections;
+    
+    // one row of windows per task
+    const size_t n_rows = (img.rows - _window.height)/_window_stride + 1;
+    const size_t n_cols = (img.cols - _window.width)/_window_stride + 1;
+    std::mutex mutex;
+    Executor& exec = _executor ? *_executor : *Executor::default_executor();
+    exec.parallel_for(0, n_rows, 1, [&](const size_t begin, const size_t end) {
+        Stats stats;
+        stats.n_rejected.assign(_stage_thresholds.size(), 0);
+        std::vector<Detection> found;
+        HOG::THist block_hist;
+        block_hist.reserve(_hog.get_block_hist_size());
+        for(size_t i = begin; i < end; ++i) {
+            for(size_t j = 0; j < n_cols; ++j) {
+                const cv::Rect rect(j*_window_stride, i*_window_stride, _window.width, _window.height);
+                float s;
+                const size_t stage = score(rect, s, block_hist, stats.n_blocks_normalized);
+                stats.n_windows++;
+                if(stage < _stage_thresholds.size())
+                    stats.n_rejected[stage]++;
+                else if(s > _threshold)
+                    found.push_back(Detection{rect, s, 1.0});
+            }
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        detections.insert(std::end(detections), std::begin(found), std::end(found));
+        _stats.n_windows += stats.n_windows;
+        _stats.n_blocks_normalized += stats.n_blocks_normalized;
+        for(size_t k = 0; k < stats.n_rejected.size(); ++k)
+            _stats.n_rejected[k] += stats.n_rejected[k];
+    });
+    
+    std::sort(std::begin(detections), std::end(detections), [](const Detection& a, const Detection& b) {
+        return a.score > b.score;
+    });
+    return detections;
+}
+
+MultiModelDetector::MultiModelDetector(const HOG& hog, const cv::Size& window, const std::vector<HOG::THist>& weights, 
+                                       const std::vector<float>& biases, const std::vector<float>& thresholds)
+    : _hog(hog), _window(window), _biases(biases), _thresholds(thresholds), _window_stride(hog.get_cellsize()) {
+        if(window.height < hog.get_blocksize() || window.width < hog.get_blocksize())
+            throw std::runtime_error("MultiModelDetector::MultiModelDetector(): the window is smaller than blocksize!");
+        if(weights.empty() || weights.size() != biases.size() || weights.size() != thresholds.size())
+            throw std::runtime_error("MultiModelDetector::MultiModelDetector(): weights, biases and thresholds must have the same (non-zero) size!");
+        const size_t size = hog.descriptor_size(window);
+        _weights.create(size, weights.size(), CV_32F);
+        for(size_t k = 0; k < weights.size(); ++k) {
+            if(weights[k].size() != size)
+                throw std::runtime_error("MultiModelDetector::MultiModelDetector(): the size of the weights doesn't match the HOG of the window!");
+            for(size_t i = 0; i < size; ++i)
+                _weights.at<float>(i, k) = weights[k][i];
+        }
+        // all the blocks are normalized at once
+        _hog.set_lazy(false);
+    }
+MultiModelDetector::~MultiModelDetector() {}
+
+void MultiModelDetector::set_window_stride(const size_t stride) {
+    if(stride == 0 || stride%_hog.get_cellsize() != 0)
+        throw std::runtime_error("MultiModelDetector::set_window_stride(): stride must be a multiple of cellsize!");
+    _window_stride = stride;
+}
+
+void MultiModelDetector::set_executor(const std::shared_ptr<Executor>& executor) {
+    _executor = executor;
+}
+
+std::vector<std::vector<Detection>> MultiModelDetector::detect(const cv::Mat& img) {
+    
+    if(!img.data)
+        throw std::runtime_error("MultiModelDetector::detect(): invalid image!");
+    
+    std::vector<std::vector<Detection>> detections(size());
+    if(img.rows < _window.height || img.cols < _window.width)
+        return detections;
+    
+    _hog.process(img);
+    const cv::Mat blocks = _hog.get_block_map();
+    
+    // geometry in cells: blocks of the map and blocks of a window
+    const size_t cellsize = _hog.get_cellsize();
+    const size_t stride_unit = _hog.get_stride()/cellsize;
+    const size_t n_cells_per_block = _hog.get_blocksize()/cellsize;
+    const size_t map_blocks_x = img.cols/cellsize - n_cells_per_block + 1;
+    const size_t window_blocks_y = (_window.height/cellsize - n_cells_per_block)/stride_unit + 1;
+    const size_t window_blocks_x = (_window.width/cellsize - n_cells_per_block)/stride_unit + 1;
+    
+    const size_t n_rows = (img.rows - _window.height)/_window_stride + 1;
+    const size_t n_cols = (img.cols - _window.width)/_window_stride + 1;
+    std::mutex mutex;
+    Executor& exec = _executor ? *_executor : *Executor::default_executor();
+    exec.parallel_for(0, n_rows, 1, [&](const size_t begin, const size_t end) {
+        // descriptors of a row of windows, one per row of the matrix
+        cv::Mat descriptors(n_cols, _weights.rows, CV_32F);
+        cv::Mat scores;
+        std::vector<std::vector<Detection>> found(size());
+        for(size_t r = begin; r < end; ++r) {
+            const size_t y = r*_window_stride/cellsize;
+            for(size_t c = 0; c < n_cols; ++c) {
+                const size_t x = c*_window_stride/cellsize;
+                float* out = descriptors.ptr<float>(c);
+                for(size_t by = 0; by < window_blocks_y; ++by) {
+                    for(size_t bx = 0; bx < window_blocks_x; ++bx) {
+                        const size_t block = (y + by*stride_unit)*map_blocks_x + x + bx*stride_unit;
+                        const float* ptr_block = blocks.ptr<float>(block);
+                        out = std::copy(ptr_block, ptr_block + blocks.cols, out);
+                    }
+                }
+            }
+            // all the models on all the windows of the row
+            cv::gemm(descriptors, _weights, 1, cv::Mat(), 0, scores);
+            for(size_t c = 0; c < n_cols; ++c) {
+                const float* ptr_scores = scores.ptr<float>(c);
+                for(size_t k = 0; k < size(); ++k) {
+                    const float score = ptr_scores[k] + _biases[k];
+                    if(score > _thresholds[k]) {
+                        const cv::Rect rect(c*_window_stride, r*_window_stride, _window.width, _window.height);
+                        found[k].push_back(Detection{rect, score, 1.0});
+                    }
+                }
+            }
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        for(size_t k = 0; k < size(); ++k)
+            detections[k].insert(std::end(detections[k]), std::begin(found[k]), std::end(found[k]));
+    });
+    
+    for(auto& model_detections : detections) {
+        std::sort(std::begin(model_detections), std::end(model_detections), [](const Detection& a, const Detection& b) {
+            return a.score > b.score;
+        });
+    }
+    return detections;
+}
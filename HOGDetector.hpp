@@ -0,0 +1,235 @@
+/*  ==========================================================================================
+    Author: Leonardo Citraro
+    Company:
+    Filename: HOGDetector.hpp
+    Last modifed:   17.10.2026 by Leonardo Citraro
+    Description:    Sliding-window detectors built on top of the HOG.
+
+    ==========================================================================================
+    Copyright (c) 2016 Leonardo Citraro <ldo.citraro@gmail.com>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this
+    software and associated documentation files (the "Software"), to deal in the Software
+    without restriction, including without limitation the rights to use, copy, modify,
+    merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+    permit persons to whom the Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be included in all copies
+    or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+    INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+    PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+    FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+    OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+    ==========================================================================================
+*/
+#ifndef HOGDETECTOR_HPP
+#define HOGDETECTOR_HPP
+
+#include "HOG.hpp"
+#include "CancellationToken.hpp"
+#include "opencv2/imgproc/imgproc.hpp"
+#include <vector>
+#include <chrono>
+#include <memory>
+
+/// A detected window
+struct Detection {
+    cv::Rect rect;  ///< window in pixels of the source image
+    float score;    ///< score of the linear model
+    double scale;   ///< downscaling factor of the pyramid level where it has been found
+};
+
+/// Multi-scale sliding-window detector with a linear model that returns the 
+/// best detections found so far when a deadline expires or when it is cancelled.
+/// The scales are processed coarse-to-fine and, inside a scale, the windows 
+/// with the highest gradient energy are scored first.
+class AnytimeDetector {
+public:
+    using Clock = std::chrono::steady_clock;
+    
+    struct Result {
+        std::vector<Detection> detections; ///< detections above the threshold, best first
+        size_t n_windows_evaluated = 0;    ///< windows scored
+        size_t n_windows_total = 0;        ///< windows of all the scales
+        size_t n_scales_processed = 0;     ///< scales whose HOG has been computed
+        double coverage = 0;               ///< fraction of the search space covered
+        bool completed = false;            ///< true if all the windows have been scored
+    };
+
+private:
+    HOG _hog;
+    cv::Size _window;       ///< size of the detection window in pixels
+    HOG::THist _weights;    ///< linear model (same layout as HOG::retrieve())
+    float _bias;
+    float _threshold;       ///< minimum score of a detection
+    double _scale_step;     ///< ratio between two consecutive scales
+    size_t _window_stride;  ///< step of the sliding window in pixels
+
+public:
+    /// @param hog: HOG object holding the configuration
+    /// @param window: size of the detection window in pixels
+    /// @param weights: weights of the linear model
+    /// @param bias: bias of the linear model
+    /// @param threshold: minimum score of a detection
+    /// @param scale_step: ratio between two consecutive scales of the pyramid (> 1)
+    AnytimeDetector(const HOG& hog, const cv::Size& window, const HOG::THist& weights, 
+                    const float bias = 0, const float threshold = 0, const double scale_step = 1.2);
+    ~AnytimeDetector();
+
+    /// Sets the step of the sliding window (the cellsize by default)
+    ///
+    /// @param stride: step in pixels, multiple of the cellsize
+    /// @return none
+    void set_window_stride(const size_t stride);
+
+    /// Detects within a time budget
+    ///
+    /// @param img: source image (any size)
+    /// @param budget: time available for the detection
+    /// @param token: token to cancel the detection from another thread
+    /// @return the detections found and the coverage of the search space
+    Result detect(const cv::Mat& img, const Clock::duration& budget, 
+                  const CancellationToken& token = CancellationToken());
+
+    /// Detects until a deadline
+    ///
+    /// @param img: source image (any size)
+    /// @param deadline: time at which the best detections found so far are returned
+    /// @param token: token to cancel the detection from another thread
+    /// @return the detections found and the coverage of the search space
+    Result detect_until(const cv::Mat& img, const Clock::time_point& deadline, 
+                        const CancellationToken& token = CancellationToken());
+};
+
+/// Single-scale sliding-window detector with a linear model evaluated as a cascade.
+/// Each stage scores a subset of the blocks of the window and rejects the window
+/// if the partial score (bias + blocks scored so far) is below the threshold of
+/// the stage. The blocks are normalized only when a stage needs them, so the 
+/// normalization of the remaining blocks is paid only by the surviving windows.
+/// The blocks not listed in any stage are scored after the last stage.
+class CascadeDetector {
+public:
+    struct Stats {
+        size_t n_windows = 0;                  ///< windows evaluated
+        std::vector<size_t> n_rejected;        ///< windows rejected by each stage
+        size_t n_blocks_normalized = 0;        ///< blocks normalized (n_windows*n_blocks without cascade)
+    };
+
+private:
+    HOG _hog;
+    cv::Size _window;       ///< size of the detection window in pixels
+    HOG::THist _weights;    ///< linear model (same layout as HOG::retrieve())
+    float _bias;
+    float _threshold;       ///< minimum score of a detection
+    size_t _window_stride;  ///< step of the sliding window in pixels
+    std::vector<std::vector<size_t>> _stages;   ///< blocks of each stage (the last one holds the remaining blocks)
+    std::vector<float> _stage_thresholds;       ///< rejection threshold of each stage
+    std::shared_ptr<Executor> _executor;        ///< runs the windows in parallel (Executor::default_executor() if null)
+    Stats _stats;
+
+public:
+    /// @param hog: HOG object holding the configuration
+    /// @param window: size of the detection window in pixels
+    /// @param weights: weights of the linear model
+    /// @param bias: bias of the linear model
+    /// @param threshold: minimum score of a detection
+    CascadeDetector(const HOG& hog, const cv::Size& window, const HOG::THist& weights, 
+                    const float bias = 0, const float threshold = 0);
+    ~CascadeDetector();
+
+    /// Appends a stage to the cascade
+    ///
+    /// @param blocks: indices of the blocks scored by the stage (see HOG::retrieve_block()),
+    ///                a block can appear in one stage only
+    /// @param threshold: the window is rejected if its partial score is below this value
+    /// @return none
+    void add_stage(const std::vector<size_t>& blocks, const float threshold);
+
+    /// Sets the step of the sliding window (the cellsize by default)
+    ///
+    /// @param stride: step in pixels, multiple of the cellsize
+    /// @return none
+    void set_window_stride(const size_t stride);
+
+    /// Sets the executor scoring the windows in parallel
+    ///
+    /// @param executor: the executor (null for the default one)
+    /// @return none
+    void set_executor(const std::shared_ptr<Executor>& executor);
+
+    /// Scores a window of the last processed image
+    ///
+    /// @param window: window in pixels
+    /// @param score: the score of the window (partial if rejected)
+    /// @return the index of the stage that rejected the window or the number of stages if accepted
+    size_t score(const cv::Rect& window, float& score);
+
+    /// Detects the windows of an image whose score is above the threshold
+    ///
+    /// @param img: source image (any size)
+    /// @return the detections, best first
+    std::vector<Detection> detect(const cv::Mat& img);
+
+    /// Statistics of the last call to CascadeDetector::detect()
+    ///
+    /// @return the statistics
+    const Stats& get_stats() const { return _stats; }
+
+private:
+    size_t score(const cv::Rect& window, float& score, HOG::THist& block_hist, size_t& n_blocks_normalized);
+};
+
+/// Sliding-window detector evaluating K linear models on the same HOG at once.
+/// The blocks of the image are normalized once (HOG::get_block_map()), the
+/// descriptors of a row of windows are stacked and multiplied by the matrix of
+/// the stacked models (GEMM), so the features are read once for all the models.
+/// The HOG can't use the rotation normalization (detect() throws).
+class MultiModelDetector {
+private:
+    HOG _hog;
+    cv::Size _window;       ///< size of the detection window in pixels
+    cv::Mat _weights;       ///< the models stacked by column, CV_32F of descriptor_size x K
+    std::vector<float> _biases;
+    std::vector<float> _thresholds; ///< minimum score of a detection of each model
+    size_t _window_stride;  ///< step of the sliding window in pixels
+    std::shared_ptr<Executor> _executor; ///< runs the rows of windows in parallel (Executor::default_executor() if null)
+
+public:
+    /// @param hog: HOG object holding the configuration
+    /// @param window: size of the detection window in pixels
+    /// @param weights: weights of each linear model (same layout as HOG::retrieve())
+    /// @param biases: bias of each linear model
+    /// @param thresholds: minimum score of a detection of each model
+    MultiModelDetector(const HOG& hog, const cv::Size& window, const std::vector<HOG::THist>& weights, 
+                       const std::vector<float>& biases, const std::vector<float>& thresholds);
+    ~MultiModelDetector();
+
+    /// Sets the step of the sliding window (the cellsize by default)
+    ///
+    /// @param stride: step in pixels, multiple of the cellsize
+    /// @return none
+    void set_window_stride(const size_t stride);
+
+    /// Sets the executor scoring the rows of windows in parallel
+    ///
+    /// @param executor: the executor (null for the default one)
+    /// @return none
+    void set_executor(const std::shared_ptr<Executor>& executor);
+
+    /// Detects the windows of an image whose score is above the threshold of each model
+    ///
+    /// @param img: source image (any size)
+    /// @return the detections of each model, best first
+    std::vector<std::vector<Detection>> detect(const cv::Mat& img);
+
+    /// Number of models
+    ///
+    /// @return the number of models
+    size_t size() const { return _biases.size(); }
+};
+
+#endif
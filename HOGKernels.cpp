@@ -0,0 +1,317 @@
+/*  ==========================================================================================
+    Author: Leonardo Citraro
+    Company:
+    Filename: HOGKernels.cpp
+    Last modifed:   17.10.2026 by Leonardo Citraro
+    Description:    Hot loops of the HOG (binning, normalization) compiled for several
+                    instruction sets and selected at runtime.
+
+    ==========================================================================================
+    Copyright (c) 2016 Leonardo Citraro <ldo.citraro@gmail.com>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this
+    software and associated documentation files (the "Software"), to deal in the Software
+    without restriction, including without limitation the rights to use, copy, modify,
+    merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+    permit persons to whom the Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be included in all copies
+    or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+    INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+    PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+    FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+    OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+    ==========================================================================================
+*/
+#include "HOGKernels.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// The variants are compiled with the target attribute of GCC/Clang so that the
+// rest of the library (and the build flags) stays generic: a single binary runs
+// on any x86-64 and uses the widest instructions of the CPU it runs on.
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define HOG_KERNELS_X86
+#include <immintrin.h>
+#endif
+
+// ------------------------------------------------------------------ generic
+static float sum_generic(const float* v, const size_t n) {
+    float s = 0;
+    for(size_t i = 0; i < n; ++i)
+        s += v[i];
+    return s;
+}
+
+static float sum_of_squares_generic(const float* v, const size_t n) {
+    float s = 0;
+    for(size_t i = 0; i < n; ++i)
+        s += v[i]*v[i];
+    return s;
+}
+
+static void scale_generic(const float* in, float* out, const size_t n, const float s) {
+    for(size_t i = 0; i < n; ++i)
+        out[i] = in[i]*s;
+}
+
+static void clip_generic(float* v, const size_t n, const float lo, const float hi) {
+    for(size_t i = 0; i < n; ++i)
+        v[i] = std::min(std::max(v[i], lo), hi);
+}
+
+static void bin_indices_generic(const float* ori, int* bins, const size_t n, const float bin_width, const float fold, const int max_bin) {
+    for(size_t i = 0; i < n; ++i) {
+        const float o = ori[i] >= fold ? ori[i] - fold : ori[i];
+        bins[i] = std::min(static_cast<int>(o / bin_width), max_bin);
+    }
+}
+
+#ifdef HOG_KERNELS_X86
+// ------------------------------------------------------------------ sse4.2
+__attribute__((target("sse4.2")))
+static float hsum_sse(__m128 v) {
+    v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+    v = _mm_add_ss(v, _mm_shuffle_ps(v, v, 1));
+    return _mm_cvtss_f32(v);
+}
+
+__attribute__((target("sse4.2")))
+static float sum_sse(const float* v, const size_t n) {
+    __m128 acc = _mm_setzero_ps();
+    size_t i = 0;
+    for(; i+4 <= n; i += 4)
+        acc = _mm_add_ps(acc, _mm_loadu_ps(v+i));
+    return hsum_sse(acc) + sum_generic(v+i, n-i);
+}
+
+__attribute__((target("sse4.2")))
+static float sum_of_squares_sse(const float* v, const size_t n) {
+    __m128 acc = _mm_setzero_ps();
+    size_t i = 0;
+    for(; i+4 <= n; i += 4) {
+        const __m128 x = _mm_loadu_ps(v+i);
+        acc = _mm_add_ps(acc, _mm_mul_ps(x, x));
+    }
+    return hsum_sse(acc) + sum_of_squares_generic(v+i, n-i);
+}
+
+__attribute__((target("sse4.2")))
+static void scale_sse(const float* in, float* out, const size_t n, const float s) {
+    const __m128 vs = _mm_set1_ps(s);
+    size_t i = 0;
+    for(; i+4 <= n; i += 4)
+        _mm_storeu_ps(out+i, _mm_mul_ps(_mm_loadu_ps(in+i), vs));
+    scale_generic(in+i, out+i, n-i, s);
+}
+
+__attribute__((target("sse4.2")))
+static void clip_sse(float* v, const size_t n, const float lo, const float hi) {
+    const __m128 vlo = _mm_set1_ps(lo);
+    const __m128 vhi = _mm_set1_ps(hi);
+    size_t i = 0;
+    for(; i+4 <= n; i += 4)
+        _mm_storeu_ps(v+i, _mm_min_ps(_mm_max_ps(_mm_loadu_ps(v+i), vlo), vhi));
+    clip_generic(v+i, n-i, lo, hi);
+}
+
+__attribute__((target("sse4.2")))
+static void bin_indices_sse(const float* ori, int* bins, const size_t n, const float bin_width, const float fold, const int max_bin) {
+    const __m128 vwidth = _mm_set1_ps(bin_width);
+    const __m128 vfold = _mm_set1_ps(fold);
+    const __m128i vmax = _mm_set1_epi32(max_bin);
+    size_t i = 0;
+    for(; i+4 <= n; i += 4) {
+        __m128 o = _mm_loadu_ps(ori+i);
+        o = _mm_sub_ps(o, _mm_and_ps(_mm_cmpge_ps(o, vfold), vfold));
+        const __m128i b = _mm_cvttps_epi32(_mm_div_ps(o, vwidth));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(bins+i), _mm_min_epi32(b, vmax));
+    }
+    bin_indices_generic(ori+i, bins+i, n-i, bin_width, fold, max_bin);
+}
+
+// ------------------------------------------------------------------ avx2
+__attribute__((target("avx2")))
+static float hsum_avx(const __m256 v) {
+    return hsum_sse(_mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1)));
+}
+
+__attribute__((target("avx2")))
+static float sum_avx2(const float* v, const size_t n) {
+    __m256 acc = _mm256_setzero_ps();
+    size_t i = 0;
+    for(; i+8 <= n; i += 8)
+        acc = _mm256_add_ps(acc, _mm256_loadu_ps(v+i));
+    return hsum_avx(acc) + sum_generic(v+i, n-i);
+}
+
+__attribute__((target("avx2")))
+static float sum_of_squares_avx2(const float* v, const size_t n) {
+    __m256 acc = _mm256_setzero_ps();
+    size_t i = 0;
+    for(; i+8 <= n; i += 8) {
+        const __m256 x = _mm256_loadu_ps(v+i);
+        acc = _mm256_add_ps(acc, _mm256_mul_ps(x, x));
+    }
+    return hsum_avx(acc) + sum_of_squares_generic(v+i, n-i);
+}
+
+__attribute__((target("avx2")))
+static void scale_avx2(const float* in, float* out, const size_t n, const float s) {
+    const __m256 vs = _mm256_set1_ps(s);
+    size_t i = 0;
+    for(; i+8 <= n; i += 8)
+        _mm256_storeu_ps(out+i, _mm256_mul_ps(_mm256_loadu_ps(in+i), vs));
+    scale_generic(in+i, out+i, n-i, s);
+}
+
+__attribute__((target("avx2")))
+static void clip_avx2(float* v, const size_t n, const float lo, const float hi) {
+    const __m256 vlo = _mm256_set1_ps(lo);
+    const __m256 vhi = _mm256_set1_ps(hi);
+    size_t i = 0;
+    for(; i+8 <= n; i += 8)
+        _mm256_storeu_ps(v+i, _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(v+i), vlo), vhi));
+    clip_generic(v+i, n-i, lo, hi);
+}
+
+__attribute__((target("avx2")))
+static void bin_indices_avx2(const float* ori, int* bins, const size_t n, const float bin_width, const float fold, const int max_bin) {
+    const __m256 vwidth = _mm256_set1_ps(bin_width);
+    const __m256 vfold = _mm256_set1_ps(fold);
+    const __m256i vmax = _mm256_set1_epi32(max_bin);
+    size_t i = 0;
+    for(; i+8 <= n; i += 8) {
+        __m256 o = _mm256_loadu_ps(ori+i);
+        o = _mm256_sub_ps(o, _mm256_and_ps(_mm256_cmp_ps(o, vfold, _CMP_GE_OQ), vfold));
+        const __m256i b = _mm256_cvttps_epi32(_mm256_div_ps(o, vwidth));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(bins+i), _mm256_min_epi32(b, vmax));
+    }
+    bin_indices_generic(ori+i, bins+i, n-i, bin_width, fold, max_bin);
+}
+
+// ------------------------------------------------------------------ avx512f
+// the headers of some GCC versions trigger false warnings in the AVX-512 intrinsics
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+__attribute__((target("avx512f")))
+static float sum_avx512(const float* v, const size_t n) {
+    __m512 acc = _mm512_setzero_ps();
+    size_t i = 0;
+    for(; i+16 <= n; i += 16)
+        acc = _mm512_add_ps(acc, _mm512_loadu_ps(v+i));
+    return _mm512_reduce_add_ps(acc) + sum_generic(v+i, n-i);
+}
+
+__attribute__((target("avx512f")))
+static float sum_of_squares_avx512(const float* v, const size_t n) {
+    __m512 acc = _mm512_setzero_ps();
+    size_t i = 0;
+    for(; i+16 <= n; i += 16) {
+        const __m512 x = _mm512_loadu_ps(v+i);
+        acc = _mm512_add_ps(acc, _mm512_mul_ps(x, x));
+    }
+    return _mm512_reduce_add_ps(acc) + sum_of_squares_generic(v+i, n-i);
+}
+
+__attribute__((target("avx512f")))
+static void scale_avx512(const float* in, float* out, const size_t n, const float s) {
+    const __m512 vs = _mm512_set1_ps(s);
+    size_t i = 0;
+    for(; i+16 <= n; i += 16)
+        _mm512_storeu_ps(out+i, _mm512_mul_ps(_mm512_loadu_ps(in+i), vs));
+    scale_generic(in+i, out+i, n-i, s);
+}
+
+__attribute__((target("avx512f")))
+static void clip_avx512(float* v, const size_t n, const float lo, const float hi) {
+    const __m512 vlo = _mm512_set1_ps(lo);
+    const __m512 vhi = _mm512_set1_ps(hi);
+    size_t i = 0;
+    for(; i+16 <= n; i += 16)
+        _mm512_storeu_ps(v+i, _mm512_min_ps(_mm512_max_ps(_mm512_loadu_ps(v+i), vlo), vhi));
+    clip_generic(v+i, n-i, lo, hi);
+}
+
+__attribute__((target("avx512f")))
+static void bin_indices_avx512(const float* ori, int* bins, const size_t n, const float bin_width, const float fold, const int max_bin) {
+    const __m512 vwidth = _mm512_set1_ps(bin_width);
+    const __m512 vfold = _mm512_set1_ps(fold);
+    const __m512i vmax = _mm512_set1_epi32(max_bin);
+    size_t i = 0;
+    for(; i+16 <= n; i += 16) {
+        __m512 o = _mm512_loadu_ps(ori+i);
+        o = _mm512_mask_sub_ps(o, _mm512_cmp_ps_mask(o, vfold, _CMP_GE_OQ), o, vfold);
+        const __m512i b = _mm512_cvttps_epi32(_mm512_div_ps(o, vwidth));
+        _mm512_storeu_si512(bins+i, _mm512_min_epi32(b, vmax));
+    }
+    bin_indices_generic(ori+i, bins+i, n-i, bin_width, fold, max_bin);
+}
+#pragma GCC diagnostic pop
+#endif
+
+// the variants, from the most generic
+static const HOGKernels variants[] = {
+    {"generic", sum_generic, sum_of_squares_generic, scale_generic, clip_generic, bin_indices_generic},
+#ifdef HOG_KERNELS_X86
+    {"sse4.2", sum_sse, sum_of_squares_sse, scale_sse, clip_sse, bin_indices_sse},
+    {"avx2", sum_avx2, sum_of_squares_avx2, scale_avx2, clip_avx2, bin_indices_avx2},
+    {"avx512f", sum_avx512, sum_of_squares_avx512, scale_avx512, clip_avx512, bin_indices_avx512},
+#endif
+};
+
+static bool cpu_supports(const std::string& name) {
+#ifdef HOG_KERNELS_X86
+    __builtin_cpu_init();
+    if(name == "sse4.2")
+        return __builtin_cpu_supports("sse4.2");
+    if(name == "avx2")
+        return __builtin_cpu_supports("avx2");
+    if(name == "avx512f")
+        return __builtin_cpu_supports("avx512f");
+#endif
+    return name == "generic";
+}
+
+const HOGKernels* find_hog_kernels(const std::string& name) {
+    for(const auto& variant : variants) {
+        if(name == variant.name)
+            return cpu_supports(name) ? &variant : nullptr;
+    }
+    return nullptr;
+}
+
+std::vector<std::string> supported_hog_kernels() {
+    std::vector<std::string> names;
+    for(const auto& variant : variants) {
+        if(cpu_supports(variant.name))
+            names.push_back(variant.name);
+    }
+    return names;
+}
+
+static const HOGKernels& select_hog_kernels() {
+    // forced variant: a typo or a variant the CPU doesn't support must not silently
+    // fall back to the best one, the override would not test what it claims
+    const char* forced = std::getenv("HOG_ISA");
+    if(forced && *forced) {
+        const HOGKernels* kernels = find_hog_kernels(forced);
+        if(!kernels)
+            throw std::runtime_error(std::string("hog_kernels(): HOG_ISA=") + forced + " is unknown or not supported by the CPU!");
+        return *kernels;
+    }
+    return *find_hog_kernels(supported_hog_kernels().back());
+}
+
+const HOGKernels& hog_kernels() {
+    static const HOGKernels& kernels = select_hog_kernels();
+    return kernels;
+}
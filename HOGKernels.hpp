@@ -0,0 +1,78 @@
+/*  ==========================================================================================
+    Author: Leonardo Citraro
+    Company:
+    Filename: HOGKernels.hpp
+    Last modifed:   17.10.2026 by Leonardo Citraro
+    Description:    Hot loops of the HOG (binning, normalization) compiled for several
+                    instruction sets. The best variant supported by the CPU is selected
+                    at startup, the environment variable HOG_ISA forces one
+                    (generic, sse4.2, avx2, avx512f).
+
+    ==========================================================================================
+    Copyright (c) 2016 Leonardo Citraro <ldo.citraro@gmail.com>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this
+    software and associated documentation files (the "Software"), to deal in the Software
+    without restriction, including without limitation the rights to use, copy, modify,
+    merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+    permit persons to whom the Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be included in all copies
+    or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+    INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+    PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+    FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+    OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+    ==========================================================================================
+*/
+#ifndef HOGKERNELS_HPP
+#define HOGKERNELS_HPP
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+/// A variant of the kernels, all the functions use the same instruction set
+struct HOGKernels {
+    const char* name; ///< generic, sse4.2, avx2 or avx512f
+    
+    /// @return the sum of the n elements of v (the order of the additions depends on
+    ///         the vector width, so the variants differ by rounding)
+    float (*sum)(const float* v, const size_t n);
+    
+    /// @return the sum of the squares of the n elements of v (multiplications and additions
+    ///         kept separate in every variant, no fused multiply-add)
+    float (*sum_of_squares)(const float* v, const size_t n);
+    
+    /// out[i] = in[i]*s for the n elements (in and out can be the same)
+    void (*scale)(const float* in, float* out, const size_t n, const float s);
+    
+    /// v[i] = min(max(v[i], lo), hi) for the n elements
+    void (*clip)(float* v, const size_t n, const float lo, const float hi);
+    
+    /// bins[i] = min(int(o/bin_width), max_bin) for the n orientations, with o = ori[i]-fold if ori[i] >= fold
+    void (*bin_indices)(const float* ori, int* bins, const size_t n, const float bin_width, const float fold, const int max_bin);
+};
+
+/// The kernels selected for this CPU (or by the environment variable HOG_ISA)
+///
+/// @return the kernels, throws if HOG_ISA names a variant that doesn't exist or 
+///         isn't supported by the CPU
+const HOGKernels& hog_kernels();
+
+/// A variant of the kernels by name
+///
+/// @param name: generic, sse4.2, avx2 or avx512f
+/// @return the kernels, null if the variant doesn't exist or isn't supported by the CPU
+const HOGKernels* find_hog_kernels(const std::string& name);
+
+/// The variants supported by the CPU
+///
+/// @return the names of the variants, from the most generic
+std::vector<std::string> supported_hog_kernels();
+
+#endif
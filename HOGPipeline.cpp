@@ -0,0 +1,129 @@
+/*  ==========================================================================================
+    Author: Leonardo Citraro
+    Company:
+    Filename: HOGPipeline.cpp
+    Last modifed:   17.10.2026 by Leonardo Citraro
+    Description:    Asynchronous HOG extraction backed by a pool of reusable buffers.
+
+    ==========================================================================================
+    Copyright (c) 2016 Leonardo Citraro <ldo.citraro@gmail.com>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this
+    software and associated documentation files (the "Software"), to deal in the Software
+    without restriction, including without limitation the rights to use, copy, modify,
+    merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+    permit persons to whom the Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be included in all copies
+    or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+    INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+    PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+    FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+    OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+    ==========================================================================================
+*/
+#include "HOGPipeline.hpp"
+#include "HOG.hpp"
+#include "opencv2/imgproc/imgproc.hpp"
+#include <memory>
+#include <vector>
+
+HOGPipeline::HOGPipeline(const HOG& hog, const size_t n_buffers) 
+    : _pool(std::make_shared<Pool>()) {
+        if(n_buffers < 1)
+            throw std::runtime_error("HOGPipeline::HOGPipeline(): at least one buffer is needed!");
+        for(size_t i = 0; i < n_buffers; ++i) {
+            _pool->buffers.emplace_back(new HOG(hog));
+            _pool->free.push_back(_pool->buffers.back().get());
+        }
+        _worker = std::thread(&HOGPipeline::run, this);
+    }
+
+HOGPipeline::~HOGPipeline() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _cv_jobs.notify_all();
+    _worker.join();
+}
+
+std::future<HOGPipeline::FeatureMapHandle> HOGPipeline::process_async(const cv::Mat& img) {
+    if(!img.data)
+        throw std::runtime_error("HOGPipeline::process_async(): invalid image!");
+    return enqueue(acquire(true), img);
+}
+
+bool HOGPipeline::try_process_async(const cv::Mat& img, std::future<FeatureMapHandle>& result) {
+    if(!img.data)
+        throw std::runtime_error("HOGPipeline::try_process_async(): invalid image!");
+    HOG* hog = acquire(false);
+    if(!hog)
+        return false;
+    result = enqueue(hog, img);
+    return true;
+}
+
+size_t HOGPipeline::n_free_buffers() {
+    std::lock_guard<std::mutex> lock(_pool->mutex);
+    return _pool->free.size();
+}
+
+HOG* HOGPipeline::acquire(const bool wait) {
+    std::unique_lock<std::mutex> lock(_pool->mutex);
+    if(wait)
+        _pool->cv_free.wait(lock, [this]{ return !_pool->free.empty(); });
+    else if(_pool->free.empty())
+        return nullptr;
+    HOG* hog = _pool->free.back();
+    _pool->free.pop_back();
+    return hog;
+}
+
+std::future<HOGPipeline::FeatureMapHandle> HOGPipeline::enqueue(HOG* hog, const cv::Mat& img) {
+    std::future<FeatureMapHandle> result;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _jobs.push_back(Job{hog, img, std::promise<FeatureMapHandle>()});
+        result = _jobs.back().promise.get_future();
+    }
+    _cv_jobs.notify_one();
+    return result;
+}
+
+void HOGPipeline::run() {
+    while(true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _cv_jobs.wait(lock, [this]{ return _stop || !_jobs.empty(); });
+            if(_jobs.empty())
+                return;
+            job = std::move(_jobs.front());
+            _jobs.pop_front();
+        }
+        
+        // the buffer goes back to the pool when the last handle is destroyed
+        std::shared_ptr<Pool> pool = _pool;
+        std::shared_ptr<HOG> hog(job.hog, [pool](HOG* h) {
+            {
+                std::lock_guard<std::mutex> lock(pool->mutex);
+                pool->free.push_back(h);
+            }
+            pool->cv_free.notify_one();
+        });
+        
+        try {
+            hog->process(job.img);
+            job.img.release();
+            job.promise.set_value(FeatureMapHandle(hog));
+        } catch(...) {
+            hog.reset();
+            job.promise.set_exception(std::current_exception());
+        }
+    }
+}
@@ -0,0 +1,139 @@
+/*  ==========================================================================================
+    Author: Leonardo Citraro
+    Company:
+    Filename: HOGPipeline.hpp
+    Last modifed:   17.10.2026 by Leonardo Citraro
+    Description:    Asynchronous HOG extraction backed by a pool of reusable
+                    feature-map buffers. The extraction of a frame overlaps with
+                    the scoring of the previous one and the capture of the next one.
+
+    ==========================================================================================
+    Copyright (c) 2016 Leonardo Citraro <ldo.citraro@gmail.com>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this
+    software and associated documentation files (the "Software"), to deal in the Software
+    without restriction, including without limitation the rights to use, copy, modify,
+    merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+    permit persons to whom the Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be included in all copies
+    or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+    INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+    PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+    FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+    OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+    ==========================================================================================
+*/
+#ifndef HOGPIPELINE_HPP
+#define HOGPIPELINE_HPP
+
+#include "HOG.hpp"
+#include "opencv2/imgproc/imgproc.hpp"
+#include <memory>
+#include <vector>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+class HOGPipeline {
+private:
+    /// Pool of feature-map buffers, shared with the handles so that 
+    /// a handle can outlive the pipeline
+    struct Pool {
+        std::mutex mutex;
+        std::condition_variable cv_free;
+        std::vector<std::unique_ptr<HOG>> buffers;
+        std::vector<HOG*> free;
+    };
+
+public:
+    /// Handle to a processed feature map. The buffer goes back to the pool
+    /// when the last copy of the handle is destroyed.
+    class FeatureMapHandle {
+    private:
+        std::shared_ptr<HOG> _hog;
+    public:
+        FeatureMapHandle() {}
+        FeatureMapHandle(const std::shared_ptr<HOG>& hog) : _hog(hog) {}
+        HOG& operator*() const { return *_hog; }
+        HOG* operator->() const { return _hog.get(); }
+        explicit operator bool() const { return static_cast<bool>(_hog); }
+        
+        /// Retrieves the HOG from an image's ROI
+        ///
+        /// @param window: image's ROI/widnow in pixels
+        /// @return the HOG histogram as std::vector
+        const HOG::THist retrieve(const cv::Rect& window) const { return _hog->retrieve(window); }
+        
+        /// Gives the buffer back to the pool before the handle is destroyed
+        ///
+        /// @return none
+        void release() { _hog.reset(); }
+    };
+
+private:
+    struct Job {
+        HOG* hog;
+        cv::Mat img;
+        std::promise<FeatureMapHandle> promise;
+    };
+
+    std::shared_ptr<Pool> _pool;
+    std::mutex _mutex; ///< protects the queue of jobs
+    std::condition_variable _cv_jobs;
+    std::deque<Job> _jobs;
+    bool _stop = false;
+    std::thread _worker;
+
+public:
+    /// @param hog: HOG object holding the configuration
+    /// @param n_buffers: number of feature-map buffers (frames in flight)
+    HOGPipeline(const HOG& hog, const size_t n_buffers = 2);
+    ~HOGPipeline();
+    
+    HOGPipeline(const HOGPipeline&) = delete;
+    HOGPipeline& operator=(const HOGPipeline&) = delete;
+
+    /// Processes an image in the background. If all the buffers are in use 
+    /// (frames being processed or handles still alive) the call blocks until 
+    /// one is released, which bounds the number of frames in flight.
+    /// The image data must not be modified until the feature map is ready.
+    ///
+    /// @param img: source image (any size)
+    /// @return a future to the handle of the processed feature map
+    std::future<FeatureMapHandle> process_async(const cv::Mat& img);
+
+    /// Same as HOGPipeline::process_async() but doesn't block when all the 
+    /// buffers are in use, e.g. to drop frames under overload.
+    ///
+    /// @param img: source image (any size)
+    /// @param result: the future to the handle of the processed feature map
+    /// @return false if no buffer was available (the image is not processed)
+    bool try_process_async(const cv::Mat& img, std::future<FeatureMapHandle>& result);
+
+    /// Number of buffers currently available
+    ///
+    /// @return the number of free buffers
+    size_t n_free_buffers();
+
+private:
+    /// Takes a free buffer from the pool
+    ///
+    /// @param wait: true to wait for a buffer if none is available
+    /// @return the buffer or nullptr
+    HOG* acquire(const bool wait);
+    
+    /// Queues an image to be processed in the given buffer
+    std::future<FeatureMapHandle> enqueue(HOG* hog, const cv::Mat& img);
+    
+    /// Background thread processing the queued images
+    void run();
+};
+
+#endif
@@ -0,0 +1,137 @@
+/*  ==========================================================================================
+    Author: Leonardo Citraro
+    Company:
+    Filename: HOGVideo.cpp
+    Last modifed:   17.10.2026 by Leonardo Citraro
+    Description:    HOG extractor for video streams from fixed cameras.
+
+    ==========================================================================================
+    Copyright (c) 2016 Leonardo Citraro <ldo.citraro@gmail.com>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this
+    software and associated documentation files (the "Software"), to deal in the Software
+    without restriction, including without limitation the rights to use, copy, modify,
+    merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+    permit persons to whom the Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be included in all copies
+    or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+    INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+    PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+    FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+    OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+    ==========================================================================================
+*/
+#include "HOGVideo.hpp"
+#include "HOG.hpp"
+#include "opencv2/imgproc/imgproc.hpp"
+#include <algorithm>
+#include <vector>
+
+HOGVideo::HOGVideo(const HOG& hog, const double threshold) 
+    : _hog(hog), _threshold(threshold) {
+        if(threshold < 0)
+            throw std::runtime_error("HOGVideo::HOGVideo(): threshold must be positive!");
+    }
+HOGVideo::~HOGVideo() {}
+
+void HOGVideo::process(const cv::Mat& frame) {
+    
+    if(!frame.data)
+        throw std::runtime_error("HOGVideo::process(): invalid frame!");
+    
+    const size_t cellsize = _hog.get_cellsize();
+    const size_t n_cells_y = frame.rows/cellsize;
+    const size_t n_cells_x = frame.cols/cellsize;
+    
+    _stats.n_frames++;
+    _stats.n_cells = n_cells_y*n_cells_x;
+    _stats.total_cells += _stats.n_cells;
+    
+    // first frame or the stream has changed
+    if(_prev.empty() || _prev.size() != frame.size() || _prev.type() != frame.type()) {
+        _hog.process(frame);
+        _prev = frame.clone();
+        _stats.n_changed_cells = _stats.n_cells;
+        _stats.n_recomputed_cells = _stats.n_cells;
+        _stats.total_recomputed_cells += _stats.n_cells;
+        return;
+    }
+    
+    cv::Mat diff;
+    cv::absdiff(frame, _prev, diff);
+    
+    // A cell has changed if its sum of absolute differences is above the threshold. 
+    // The last row/column of cells also covers the pixels left over at the border, 
+    // because they take part in the gradient of those cells.
+    auto cell_rect = [&](const size_t i, const size_t j) {
+        const int x = j*cellsize;
+        const int y = i*cellsize;
+        const int width = j+1 == n_cells_x ? frame.cols-x : cellsize;
+        const int height = i+1 == n_cells_y ? frame.rows-y : cellsize;
+        return cv::Rect(x, y, width, height);
+    };
+    std::vector<unsigned char> changed(n_cells_y*n_cells_x, 0);
+    std::vector<cv::Rect> dirty;
+    _stats.n_changed_cells = 0;
+    for(size_t i = 0; i < n_cells_y; ++i) {
+        for(size_t j = 0; j < n_cells_x; ++j) {
+            const cv::Rect r = cell_rect(i, j);
+            const cv::Scalar sad = cv::sum(cv::Mat(diff, r));
+            const double total = sad[0] + sad[1] + sad[2] + sad[3];
+            if(total <= _threshold*r.area()*frame.channels())
+                continue;
+            changed[i*n_cells_x + j] = 1;
+            _stats.n_changed_cells++;
+            
+            // the reference frame follows the recomputed cells, so that slow 
+            // changes below the threshold are still detected over time
+            cv::Mat ref(_prev, r);
+            cv::Mat(frame, r).copyTo(ref);
+            
+            // consecutive changed cells of a row are merged in one region
+            if(!dirty.empty() && j > 0 && changed[i*n_cells_x + j-1])
+                dirty.back().width += r.width;
+            else
+                dirty.push_back(r);
+        }
+    }
+    
+    // the changed cells and their neighbours are recomputed by HOG::update()
+    // because of the one-pixel halo of the gradient
+    _stats.n_recomputed_cells = 0;
+    for(size_t i = 0; i < n_cells_y; ++i) {
+        for(size_t j = 0; j < n_cells_x; ++j) {
+            bool recomputed = false;
+            for(size_t k = (i>0 ? i-1 : 0); k < std::min(i+2, n_cells_y) && !recomputed; ++k)
+                for(size_t l = (j>0 ? j-1 : 0); l < std::min(j+2, n_cells_x) && !recomputed; ++l)
+                    recomputed = changed[k*n_cells_x + l];
+            if(recomputed)
+                _stats.n_recomputed_cells++;
+        }
+    }
+    _stats.total_recomputed_cells += _stats.n_recomputed_cells;
+    
+    if(!dirty.empty())
+        _hog.update(_prev, dirty);
+}
+
+const HOG::THist HOGVideo::retrieve(const cv::Rect& window) {
+    return _hog.retrieve(window);
+}
+
+void HOGVideo::reset() {
+    _prev.release();
+}
+
+HOG& HOGVideo::get_hog() {
+    return _hog;
+}
+
+const HOGVideo::Stats& HOGVideo::get_stats() const {
+    return _stats;
+}
@@ -0,0 +1,91 @@
+/*  ==========================================================================================
+    Author: Leonardo Citraro
+    Company:
+    Filename: HOGVideo.hpp
+    Last modifed:   17.10.2026 by Leonardo Citraro
+    Description:    HOG extractor for video streams from fixed cameras.
+                    Only the cells that changed since the previous frame (and
+                    their neighbours) are recomputed.
+
+    ==========================================================================================
+    Copyright (c) 2016 Leonardo Citraro <ldo.citraro@gmail.com>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this
+    software and associated documentation files (the "Software"), to deal in the Software
+    without restriction, including without limitation the rights to use, copy, modify,
+    merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+    permit persons to whom the Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be included in all copies
+    or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+    INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+    PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+    FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+    OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+    ==========================================================================================
+*/
+#ifndef HOGVIDEO_HPP
+#define HOGVIDEO_HPP
+
+#include "HOG.hpp"
+#include "opencv2/imgproc/imgproc.hpp"
+#include <vector>
+
+class HOGVideo {
+public:
+    /// Statistics about the cells recomputed
+    struct Stats {
+        size_t n_frames = 0;                ///< number of frames processed
+        size_t n_cells = 0;                 ///< number of cells in a frame
+        size_t n_changed_cells = 0;         ///< cells changed in the last frame
+        size_t n_recomputed_cells = 0;      ///< cells recomputed in the last frame (changed cells and neighbours)
+        size_t total_cells = 0;             ///< cells of all the frames processed
+        size_t total_recomputed_cells = 0;  ///< cells recomputed over all the frames processed
+    };
+
+private:
+    HOG _hog;
+    cv::Mat _prev; ///< reference frame the cell histograms have been computed from
+    double _threshold; ///< mean absolute difference per pixel above which a cell has changed
+    Stats _stats;
+
+public:
+    HOGVideo(const HOG& hog, const double threshold = 0);
+    ~HOGVideo();
+
+    /// Processes a new frame. The first frame (or a frame of a different size) is 
+    /// fully processed. For the next ones, the cells are compared to the previous
+    /// frame (sum of absolute differences) and only the changed cells and their 
+    /// neighbours are recomputed.
+    ///
+    /// @param frame: new frame of the video (same size as the previous one)
+    /// @return none
+    void process(const cv::Mat& frame);
+
+    /// Retrieves the HOG from a ROI of the last frame
+    ///
+    /// @param window: image's ROI/widnow in pixels
+    /// @return the HOG histogram as std::vector
+    const HOG::THist retrieve(const cv::Rect& window);
+
+    /// Forgets the previous frame, the next frame is fully processed
+    ///
+    /// @return none
+    void reset();
+
+    /// Access to the underlying HOG object
+    ///
+    /// @return reference to the HOG object
+    HOG& get_hog();
+
+    /// Statistics about the cells recomputed
+    ///
+    /// @return the statistics
+    const Stats& get_stats() const;
+};
+
+#endif
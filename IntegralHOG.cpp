@@ -0,0 +1,253 @@
+/*  ==========================================================================================
+    Author: Leonardo Citraro
+    Company:
+    Filename: IntegralHOG.cpp
+    Last modifed:   17.10.2026 by Leonardo Citraro
+    Description:    Histograms of oriented gradients of arbitrary regions.
+
+    ==========================================================================================
+    Copyright (c) 2016 Leonardo Citraro <ldo.citraro@gmail.com>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this
+    software and associated documentation files (the "Software"), to deal in the Software
+    without restriction, including without limitation the rights to use, copy, modify,
+    merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+    permit persons to whom the Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be included in all copies
+    or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+    INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+    PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+    FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+    OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+    ==========================================================================================
+*/
+#include "IntegralHOG.hpp"
+#include "opencv2/imgproc/imgproc.hpp"
+#include <algorithm>
+#include <vector>
+#include <mutex>
+
+IntegralHOG::IntegralHOG(const size_t binning, const size_t grad_type, const HOG::BLOCK_NORM block_norm)
+    : _grad_type(grad_type), _binning(binning), _bin_width(static_cast<TType>(grad_type)/binning),
+      _norm_function(block_norm), _block_norm(get_block_norm(block_norm)) {
+        if(binning < 1)
+            throw std::runtime_error("IntegralHOG::IntegralHOG(): binning must be at least 1!");
+        if(grad_type != HOG::GRADIENT_SIGNED && grad_type != HOG::GRADIENT_UNSIGNED)
+            throw std::runtime_error("IntegralHOG::IntegralHOG(): grad_type must be GRADIENT_SIGNED or GRADIENT_UNSIGNED!");
+    }
+IntegralHOG::~IntegralHOG() {}
+
+void IntegralHOG::process(const cv::Mat& img) {
+    process(img, CancellationToken());
+}
+
+void IntegralHOG::process(const cv::Mat& img, const CancellationToken& token, const ProgressCallback& progress) {
+    if(!img.data)
+        throw std::runtime_error("IntegralHOG::process(): invalid image!");
+    if(memory_size(img.size()) > _max_memory)
+        throw std::runtime_error("IntegralHOG::process(): the integral histograms of the image exceed the memory limit (see IntegralHOG::set_max_memory())!");
+    
+    cv::Mat Dx, Dy, mag, ori;
+    cv::filter2D(img, Dx, CV_32F, _kernelx);
+    cv::filter2D(img, Dy, CV_32F, _kernely);
+    cv::magnitude(Dx, Dy, mag);
+    cv::phase(Dx, Dy, ori, true);
+    
+    _rows = img.rows;
+    _cols = img.cols;
+    const size_t row_size = (_cols+1)*_binning;
+    _integral.assign((_rows+1)*row_size, 0);
+    
+    // each pass counts for half of the progress
+    std::mutex progress_mutex;
+    float progress_done = 0;
+    auto report = [&](const float amount) {
+        if(progress) {
+            std::lock_guard<std::mutex> lock(progress_mutex);
+            progress_done += amount;
+            progress(std::min(progress_done, 1.0f));
+        }
+    };
+    
+    Executor& exec = executor();
+    // 1st pass: cumulative sums along x, the rows are independent
+    exec.parallel_for(0, _rows, 1, [&](const size_t begin, const size_t end) {
+        if(token.is_cancelled())
+            return;
+        std::vector<double> hist(_binning);
+        for(size_t i = begin; i < end; ++i) {
+            std::fill(std::begin(hist), std::end(hist), 0);
+            const TType* ptr_row_mag = mag.ptr<TType>(i);
+            const TType* ptr_row_ori = ori.ptr<TType>(i);
+            double* row = &_integral[(i+1)*row_size];
+            for(int j = 0; j < _cols; ++j) {
+                TType orientation = ptr_row_ori[j];
+                if(_grad_type == HOG::GRADIENT_UNSIGNED && orientation >= 180)
+                    orientation -= 180;
+                const size_t bin = std::min(static_cast<size_t>(orientation / _bin_width), _binning-1);
+                hist[bin] += ptr_row_mag[j];
+                std::copy(std::begin(hist), std::end(hist), row + (j+1)*_binning);
+            }
+        }
+        report(0.5f*(end - begin)/_rows);
+    });
+    // 2nd pass: cumulative sums along y, the columns are independent
+    const size_t grain = std::max<size_t>(row_size/(4*exec.concurrency()), 64);
+    exec.parallel_for(0, row_size, grain, [&](const size_t begin, const size_t end) {
+        if(token.is_cancelled())
+            return;
+        for(int i = 1; i < _rows; ++i) {
+            const double* prev_row = &_integral[i*row_size];
+            double* row = &_integral[(i+1)*row_size];
+            for(size_t k = begin; k < end; ++k)
+                row[k] += prev_row[k];
+        }
+        report(0.5f*(end - begin)/row_size);
+    });
+    
+    if(token.is_cancelled()) {
+        _integral.clear();
+        _rows = 0;
+        _cols = 0;
+        throw OperationCancelled("IntegralHOG::process(): cancelled!");
+    }
+}
+
+void IntegralHOG::region_histogram(const cv::Rect& rect, TType* hist) const {
+    const size_t row_size = (_cols+1)*_binning;
+    const double* a = &_integral[rect.y*row_size + rect.x*_binning];
+    const double* b = &_integral[rect.y*row_size + (rect.x+rect.width)*_binning];
+    const double* c = &_integral[(rect.y+rect.height)*row_size + rect.x*_binning];
+    const double* d = &_integral[(rect.y+rect.height)*row_size + (rect.x+rect.width)*_binning];
+    for(size_t k = 0; k < _binning; ++k)
+        hist[k] = static_cast<TType>(d[k] - b[k] - c[k] + a[k]);
+}
+
+const IntegralHOG::THist IntegralHOG::retrieve(const cv::Rect& window, const std::vector<Block>& blocks) const {
+    THist hist;
+    hist.reserve(descriptor_size(blocks));
+    THist block_hist;
+    for(const auto& block : blocks) {
+        retrieve_block(window, block, block_hist);
+        hist.insert(std::end(hist), std::begin(block_hist), std::end(block_hist));
+    }
+    return hist;
+}
+
+void IntegralHOG::retrieve_block(const cv::Rect& window, const Block& block, THist& block_hist) const {
+    if(_integral.empty())
+        throw std::runtime_error("IntegralHOG::retrieve_block(): no image has been processed!");
+    if(block.n_cells_y < 1 || block.n_cells_x < 1 || block.rect.height < block.n_cells_y || block.rect.width < block.n_cells_x)
+        throw std::runtime_error("IntegralHOG::retrieve_block(): the block is smaller than its cells!");
+    const cv::Rect rect(window.x + block.rect.x, window.y + block.rect.y, block.rect.width, block.rect.height);
+    if(rect.x < 0 || rect.y < 0 || rect.x > _cols-rect.width || rect.y > _rows-rect.height)
+        throw std::runtime_error("IntegralHOG::retrieve_block(): the block goes outside of the bounds of the image!");
+    
+    // the cells split the block evenly, the last row/column of cells takes the remainder
+    block_hist.resize(block.n_cells_y*block.n_cells_x*_binning);
+    const int cell_h = rect.height/block.n_cells_y;
+    const int cell_w = rect.width/block.n_cells_x;
+    TType* out = block_hist.data();
+    for(size_t i = 0; i < block.n_cells_y; ++i) {
+        const int y = rect.y + i*cell_h;
+        const int h = (i == block.n_cells_y-1) ? rect.y + rect.height - y : cell_h;
+        for(size_t j = 0; j < block.n_cells_x; ++j) {
+            const int x = rect.x + j*cell_w;
+            const int w = (j == block.n_cells_x-1) ? rect.x + rect.width - x : cell_w;
+            region_histogram(cv::Rect(x, y, w, h), out);
+            out += _binning;
+        }
+    }
+    _block_norm(block_hist);
+}
+
+void IntegralHOG::interpolate(const float y, const float x, double* hist) const {
+    const size_t row_size = (_cols+1)*_binning;
+    const int y0 = std::min(static_cast<int>(y), _rows-1);
+    const int x0 = std::min(static_cast<int>(x), _cols-1);
+    const double wy = y - y0;
+    const double wx = x - x0;
+    const double w00 = (1-wy)*(1-wx), w01 = (1-wy)*wx, w10 = wy*(1-wx), w11 = wy*wx;
+    const double* a = &_integral[y0*row_size + x0*_binning];
+    const double* b = a + _binning;
+    const double* c = a + row_size;
+    const double* d = c + _binning;
+    // contiguous bins: vectorized by the compiler
+    for(size_t k = 0; k < _binning; ++k)
+        hist[k] = w00*a[k] + w01*b[k] + w10*c[k] + w11*d[k];
+}
+
+cv::Mat IntegralHOG::describe_points(const std::vector<cv::Point2f>& points, const float patch_size, 
+                                     const size_t n_cells) const {
+    if(_integral.empty())
+        throw std::runtime_error("IntegralHOG::describe_points(): no image has been processed!");
+    if(n_cells < 1 || patch_size <= 0)
+        throw std::runtime_error("IntegralHOG::describe_points(): invalid patch!");
+    
+    const size_t n_corners = n_cells+1;
+    const size_t size = n_cells*n_cells*_binning;
+    cv::Mat descriptors(points.size(), size, CV_32F);
+    Executor& exec = executor();
+    const size_t grain = std::max<size_t>(1, std::min<size_t>(points.size()/(4*exec.concurrency()), 256));
+    exec.parallel_for(0, points.size(), grain, [&](const size_t begin, const size_t end) {
+        // the corners are shared by up to 4 cells, they are interpolated once
+        std::vector<double> corners(n_corners*n_corners*_binning);
+        std::vector<float> ys(n_corners), xs(n_corners);
+        THist hist(size);
+        const float cell_size = patch_size/n_cells;
+        for(size_t p = begin; p < end; ++p) {
+            const float top = points[p].y - patch_size/2;
+            const float left = points[p].x - patch_size/2;
+            for(size_t i = 0; i < n_corners; ++i) {
+                ys[i] = std::min(std::max(top + i*cell_size, 0.0f), static_cast<float>(_rows));
+                xs[i] = std::min(std::max(left + i*cell_size, 0.0f), static_cast<float>(_cols));
+            }
+            for(size_t i = 0; i < n_corners; ++i)
+                for(size_t j = 0; j < n_corners; ++j)
+                    interpolate(ys[i], xs[j], &corners[(i*n_corners + j)*_binning]);
+            TType* out = hist.data();
+            for(size_t i = 0; i < n_cells; ++i) {
+                for(size_t j = 0; j < n_cells; ++j) {
+                    const double* a = &corners[(i*n_corners + j)*_binning];
+                    const double* b = a + _binning;
+                    const double* c = a + n_corners*_binning;
+                    const double* d = c + _binning;
+                    for(size_t k = 0; k < _binning; ++k)
+                        out[k] = static_cast<TType>(d[k] - b[k] - c[k] + a[k]);
+                    out += _binning;
+                }
+            }
+            _block_norm(hist);
+            std::copy(std::begin(hist), std::end(hist), descriptors.ptr<TType>(p));
+        }
+    });
+    return descriptors;
+}
+
+void IntegralHOG::set_executor(const std::shared_ptr<Executor>& executor) {
+    _executor = executor;
+}
+
+void IntegralHOG::set_max_memory(const size_t bytes) {
+    _max_memory = bytes;
+}
+
+Executor& IntegralHOG::executor() const {
+    return _executor ? *_executor : *Executor::default_executor();
+}
+
+size_t IntegralHOG::descriptor_size(const std::vector<Block>& blocks) const {
+    size_t size = 0;
+    for(const auto& block : blocks)
+        size += block.n_cells_y*block.n_cells_x*_binning;
+    return size;
+}
+
+size_t IntegralHOG::memory_size(const cv::Size& image) const {
+    return static_cast<size_t>(image.height+1)*(image.width+1)*_binning*sizeof(double);
+}
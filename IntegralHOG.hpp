@@ -0,0 +1,179 @@
+/*  ==========================================================================================
+    Author: Leonardo Citraro
+    Company:
+    Filename: IntegralHOG.hpp
+    Last modifed:   17.10.2026 by Leonardo Citraro
+    Description:    Histograms of oriented gradients of arbitrary regions.
+                    Per-bin integral images are built once per image so that the
+                    histogram of any rectangle is obtained in O(binning) and blocks
+                    of any size and aspect ratio can be evaluated (Zhu et al. 2006).
+
+    ==========================================================================================
+    Copyright (c) 2016 Leonardo Citraro <ldo.citraro@gmail.com>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this
+    software and associated documentation files (the "Software"), to deal in the Software
+    without restriction, including without limitation the rights to use, copy, modify,
+    merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+    permit persons to whom the Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be included in all copies
+    or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+    INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+    PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+    FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+    OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+    ==========================================================================================
+*/
+#ifndef INTEGRALHOG_HPP
+#define INTEGRALHOG_HPP
+
+#include "HOG.hpp"
+#include "Executor.hpp"
+#include "opencv2/imgproc/imgproc.hpp"
+#include <memory>
+#include <vector>
+
+class IntegralHOG {
+public:
+    using TType = HOG::TType;
+    using THist = HOG::THist;
+    
+    /// A block of variable size. The block is split in n_cells_y x n_cells_x 
+    /// cells whose histograms are concatenated and normalized together.
+    struct Block {
+        cv::Rect rect;          ///< block in pixels, relative to the top-left corner of the window
+        size_t n_cells_y = 2;   ///< number of cells along y
+        size_t n_cells_x = 2;   ///< number of cells along x
+    };
+
+private:
+    size_t _grad_type; ///< "signed" (0..360) or "unsigned" (0..180) gradient
+    size_t _binning; ///< the number of bins for each histogram
+    TType _bin_width; ///< size of one bin in degree
+    HOG::BLOCK_NORM _norm_function;
+    std::function<void(THist&)> _block_norm; ///< function that normalize the block histogram
+    const cv::Mat _kernelx = (cv::Mat_<char>(1, 3) << -1, 0, 1); ///< derivive kernel
+    const cv::Mat _kernely = (cv::Mat_<char>(3, 1) << -1, 0, 1); ///< derivive kernel
+    
+    int _rows = 0; ///< size of the processed image
+    int _cols = 0;
+    /// integral histograms, bins interleaved: element (y, x, bin) is the sum of the 
+    /// magnitudes of the pixels above and on the left of (y, x) falling in bin.
+    /// Stored as double to keep the precision on big images, that is 
+    /// (rows+1)*(cols+1)*binning*8 bytes: ~22 MB for 640x480 and 9 bins, ~150 MB
+    /// for 1920x1080 and ~600 MB for 3840x2160 (see IntegralHOG::set_max_memory()).
+    std::vector<double> _integral;
+    size_t _max_memory = 256*1024*1024; ///< process() rejects the images whose integral histograms need more bytes
+    
+    std::shared_ptr<Executor> _executor; ///< runs the parallel loops (Executor::default_executor() if null)
+
+public:
+    /// @param binning: the number of bins for each histogram
+    /// @param grad_type: signed (HOG::GRADIENT_SIGNED) or unsigned (HOG::GRADIENT_UNSIGNED) gradient
+    /// @param block_norm: the normalization applied to each block
+    IntegralHOG(const size_t binning = 9, const size_t grad_type = HOG::GRADIENT_UNSIGNED, 
+                const HOG::BLOCK_NORM block_norm = HOG::BLOCK_NORM::L1norm);
+    ~IntegralHOG();
+    
+    /// Builds the integral histograms of an image. Throws if they would need more
+    /// memory than the limit (see IntegralHOG::set_max_memory()).
+    ///
+    /// @param img: source image (any size)
+    /// @return none
+    void process(const cv::Mat& img);
+    
+    /// Same as IntegralHOG::process() but can be cancelled and reports its progress
+    /// (see HOG::process()). The token and the progress are checked after each chunk
+    /// of rows (first pass) and of columns (second pass).
+    ///
+    /// @param img: source image (any size)
+    /// @param token: token to cancel the processing from another thread
+    /// @param progress: callback receiving the progress (can be null)
+    /// @return none, throws OperationCancelled if cancelled
+    void process(const cv::Mat& img, const CancellationToken& token, const ProgressCallback& progress = nullptr);
+    
+    /// Histogram of the gradients of a region of the image in O(binning)
+    ///
+    /// @param rect: region in pixels
+    /// @param hist: where to store the histogram (binning elements)
+    /// @return none
+    void region_histogram(const cv::Rect& rect, TType* hist) const;
+    
+    /// Retrieves the features of a window: the normalized histograms of the
+    /// blocks, concatenated in the order of the list
+    ///
+    /// @param window: image's ROI/widnow in pixels
+    /// @param blocks: blocks relative to the window
+    /// @return the features as std::vector
+    const THist retrieve(const cv::Rect& window, const std::vector<Block>& blocks) const;
+    
+    /// Retrieves the normalized histogram of a single block of a window
+    /// (e.g. a weak learner of a boosted cascade)
+    ///
+    /// @param window: image's ROI/widnow in pixels
+    /// @param block: block relative to the window
+    /// @param block_hist: where to store the block (its capacity is reused)
+    /// @return none
+    void retrieve_block(const cv::Rect& window, const Block& block, THist& block_hist) const;
+    
+    /// Describes square patches centered on keypoints at sub-pixel positions. 
+    /// The patch is split in n_cells x n_cells cells whose histograms are read 
+    /// from the integral histograms interpolated bilinearly at the corners,
+    /// then concatenated and normalized. The parts of a patch outside of the
+    /// image don't contribute. The points are described in parallel.
+    ///
+    /// @param points: centers of the patches in pixels
+    /// @param patch_size: side of the patches in pixels
+    /// @param n_cells: number of cells along each side of a patch
+    /// @return CV_32F matrix with one descriptor of n_cells*n_cells*binning elements per row
+    cv::Mat describe_points(const std::vector<cv::Point2f>& points, const float patch_size = 16, 
+                            const size_t n_cells = 4) const;
+    
+    /// Sets the executor running the parallel loops (see HOG::set_executor())
+    ///
+    /// @param executor: the executor (null for the default one)
+    /// @return none
+    void set_executor(const std::shared_ptr<Executor>& executor);
+    
+    /// Sets the maximum memory of the integral histograms (256 MB by default). 
+    /// Bigger images must be downscaled or split in tiles before IntegralHOG::process().
+    ///
+    /// @param bytes: the maximum number of bytes
+    /// @return none
+    void set_max_memory(const size_t bytes);
+    
+    size_t get_binning() const { return _binning; }
+    size_t get_max_memory() const { return _max_memory; }
+    size_t get_grad_type() const { return _grad_type; }
+    HOG::BLOCK_NORM get_norm_function() const { return _norm_function; }
+    
+    /// Utility funtion to compute the size of the features of a list of blocks
+    ///
+    /// @param blocks: blocks relative to the window
+    /// @return the number of elements returned by IntegralHOG::retrieve()
+    size_t descriptor_size(const std::vector<Block>& blocks) const;
+    
+    /// Utility funtion to compute the memory of the integral histograms of an image
+    ///
+    /// @param image: size of the image in pixels
+    /// @return the number of bytes needed by IntegralHOG::process()
+    size_t memory_size(const cv::Size& image) const;
+
+private:
+    /// Integral histogram at a sub-pixel position, interpolated bilinearly
+    ///
+    /// @param y: row in [0, rows]
+    /// @param x: column in [0, cols]
+    /// @param hist: where to store the histogram (binning elements)
+    /// @return none
+    void interpolate(const float y, const float x, double* hist) const;
+    
+    Executor& executor() const;
+};
+
+#endif
@@ -31,6 +31,9 @@ int main(int argc, char* argv[])
     // IO variables
     fs::path input_path (argv[1]);
     fs::path output_file (argv[2]);
+    // optional: "--resample" describes the whole image resampled to the grid of the crop
+    // instead of the top-left crop
+    bool resample = argc > 3 && std::string(argv[3]) == "--resample";
 
     // Retrieve the HOG from the image
     size_t crop_height = 256; //atoi(argv[3]);
@@ -62,28 +65,49 @@ int main(int argc, char* argv[])
     cv::Mat hog_features (filenames.size(), hog_size, CV_32FC1);
     
     // Loop over images (measure time)
+    // The images are processed in batches: the work-stealing scheduler of HOG::process_batch()
+    // keeps all the cores busy even when the sizes of the images are very different.
+    // A batch is closed when it reaches max_batch_pixels to bound the memory used.
+    const size_t max_batch_pixels = 64*1024*1024;
+    const size_t max_batch_images = 256;
     std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
     int n = filenames.size();
-    for (int i = 0; i < n; i++)
+    std::vector<HOG> hogs;
+    for (int first = 0; first < n; )
     {
-        string filepath = (input_path / fs::path(filenames[i])).string();
-        cv::Mat image = cv::imread(filepath, CV_LOAD_IMAGE_UNCHANGED);
-        cv::Mat image_crop;
-        cv::resize( image, image_crop, cv::Size(crop_width, crop_height) );
+        std::vector<cv::Mat> images;
+        size_t batch_pixels = 0;
+        for (int i = first; i < n && batch_pixels < max_batch_pixels && images.size() < max_batch_images; i++)
+        {
+            string filepath = (input_path / fs::path(filenames[i])).string();
+            cv::Mat image = cv::imread(filepath, CV_LOAD_IMAGE_UNCHANGED);
+            images.push_back(image);
+            batch_pixels += image.total();
+        }
+        
+        hog.process_batch(images, hogs);
     
-        if (verbose > 0)
-            cout << '(' << i << '/' << n-1 << ')' << ' ' << filenames[i] << ' ';
+        for (int k = 0; k < images.size(); k++)
+        {
+            int i = first + k;
+            if (verbose > 0)
+                cout << '(' << i << '/' << n-1 << ')' << ' ' << filenames[i] << ' ';
 
-        hog.process(image);
-        auto hist = hog.retrieve(cv::Rect(0,0,image_crop.cols, image_crop.rows));
-    
-        assert(hist.size() == hog_size);
-        
-        for (int k = 0; k < hist.size(); k++)
-            hog_features.at<float>(i,k) = hist[k];
+            // with --resample the cells of the whole image are resampled to the grid of
+            // the crop, so the images don't need to be resized to the size of the crop
+            auto hist = resample ? hogs[k].retrieve_resampled(cv::Rect(0,0,images[k].cols, images[k].rows),
+                                                              crop_height/cellsize, crop_width/cellsize)
+                                 : hogs[k].retrieve(cv::Rect(0,0,crop_width, crop_height));
         
-        if (verbose > 0)
-            cout << " -> DONE" << '\n';
+            assert(hist.size() == hog_size);
+            
+            for (int j = 0; j < hist.size(); j++)
+                hog_features.at<float>(i,j) = hist[j];
+            
+            if (verbose > 0)
+                cout << " -> DONE" << '\n';
+        }
+        first += images.size();
     }
     
     cv::FileStorage fs;
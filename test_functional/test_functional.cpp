@@ -10,10 +10,20 @@
     =========================================================================
 */
 #include "HOG.hpp"
+#include "HOGBank.hpp"
+#include "HOGVideo.hpp"
+#include "HOGPipeline.hpp"
+#include "HOGDetector.hpp"
+#include "IntegralHOG.hpp"
+#include "HOGCorrelator.hpp"
+#include "DPMDetector.hpp"
+#include "HOGKernels.hpp"
 #include "opencv2/imgproc/imgproc.hpp"
 #include "opencv2/highgui/highgui.hpp"
 #include <iostream>
 #include <algorithm>
+#include <numeric>
+#include <cmath>
 #include <memory>
 #include <iomanip>
 
@@ -105,6 +115,16 @@ int main(int argc, char* argv[]) {
         auto hist = hog.retrieve(cv::Rect(0,1,16,32));
         std::cout << "Test window.y out of image failed!\n"; exit(-1);
     } catch(...) { }
+    try {
+        hog.process(cv::Mat::ones(32,16,CV_8U));
+        auto hist = hog.retrieve(cv::Rect(-8,0,16,32));
+        std::cout << "Test negative window.x failed!\n"; exit(-1);
+    } catch(const std::runtime_error&) { }
+    try {
+        hog.process(cv::Mat::ones(64,64,CV_8U), {cv::Rect(0,0,32,32)});
+        auto hist = hog.retrieve(cv::Rect(0,-16,32,32));
+        std::cout << "Test negative window.y (ROIs) failed!\n"; exit(-1);
+    } catch(const std::runtime_error&) { }
 
     {
         cv::Mat img = cv::Mat::ones(32,32,CV_8U);
@@ -218,6 +238,1119 @@ int main(int argc, char* argv[]) {
         }
     }
     
+    {   // Testing the HOG bank: each configuration of the bank must give the
+        // same result as the corresponding HOG object used alone.
+        
+        // full image
+        cv::Mat image = cv::imread("../img/astronaut.JPG", CV_8U);
+        
+        std::vector<HOG> hogs = {HOG(16, 8, 8, 9, HOG::GRADIENT_UNSIGNED, HOG::BLOCK_NORM::L2hys),
+                                 HOG(12, 6, 6, 12, HOG::GRADIENT_SIGNED, HOG::BLOCK_NORM::L2hys),
+                                 HOG(32, 16, 16, 9, HOG::GRADIENT_UNSIGNED, HOG::BLOCK_NORM::L2hys)};
+        HOGBank bank(hogs);
+        bank.process(image);
+        
+        for(size_t k=0; k<hogs.size(); ++k) {
+            hogs[k].process(image);
+            auto hist1 = hogs[k].retrieve(cv::Rect(0,0,image.cols,image.rows));
+            auto hist2 = bank.retrieve(k, cv::Rect(0,0,image.cols,image.rows));
+            if(hist1.size() != hist2.size()) {
+                std::cout << "Test HOG bank failed (hist size wrong)!\n";  exit(-1);
+            }
+            for(int i=0; i<hist1.size(); ++i) {
+                if(std::abs(hist1[i]-hist2[i])>1e-4) {
+                    std::cout << "Test HOG bank failed!\n";  exit(-1);
+                }
+            }
+        }
+    }
+    
+    {   // Testing the ROI-restricted processing: the windows inside the ROIs
+        // must give the same result as the full processing, the others are rejected.
+        
+        // full image
+        cv::Mat image = cv::imread("../img/astronaut.JPG", CV_8U);
+        
+        HOG hog1(16, 8, 8, 9, HOG::GRADIENT_UNSIGNED, HOG::BLOCK_NORM::L2hys);
+        HOG hog2(16, 8, 8, 9, HOG::GRADIENT_UNSIGNED, HOG::BLOCK_NORM::L2hys);
+        std::vector<cv::Rect> rois = {cv::Rect(16,24,64,128), cv::Rect(200,100,64,64)};
+        
+        hog1.process(image);
+        hog2.process(image, rois);
+        for(const auto& r : rois) {
+            auto hist1 = hog1.retrieve(r);
+            auto hist2 = hog2.retrieve(r);
+            for(int i=0; i<hist1.size(); ++i) {
+                if(std::abs(hist1[i]-hist2[i])>1e-4) {
+                    std::cout << "Test ROI process failed!\n";  exit(-1);
+                }
+            }
+        }
+        try {
+            auto hist = hog2.retrieve(cv::Rect(100,100,64,64));
+            std::cout << "Test window outside of the ROIs failed!\n"; exit(-1);
+        } catch(...) { }
+    }
+    
+    {   // Testing the lazy mode: the cells computed on demand (concurrently)
+        // must give the same result as the eager processing.
+        
+        // full image
+        cv::Mat image = cv::imread("../img/astronaut.JPG", CV_8U);
+        
+        HOG hog1(16, 8, 8, 9, HOG::GRADIENT_UNSIGNED, HOG::BLOCK_NORM::L2hys);
+        HOG hog2(16, 8, 8, 9, HOG::GRADIENT_UNSIGNED, HOG::BLOCK_NORM::L2hys);
+        hog2.set_lazy(true);
+        
+        hog1.process(image);
+        hog2.process(image);
+        
+        bool failed = false;
+        #pragma omp parallel for reduction(||:failed)
+        for(int y=0; y<image.rows-128; y += 40) {
+            cv::Rect r = cv::Rect(64, y, 64, 128);
+            auto hist1 = hog1.retrieve(r);
+            auto hist2 = hog2.retrieve(r);
+            for(int i=0; i<hist1.size(); ++i) {
+                if(std::abs(hist1[i]-hist2[i])>1e-4)
+                    failed = true;
+            }
+        }
+        if(failed) {
+            std::cout << "Test lazy mode failed!\n";  exit(-1);
+        }
+    }
+    
+    {   // Testing the incremental update: updating a dirty region must give
+        // the same result as processing the modified image from scratch.
+        
+        // full image
+        cv::Mat image = cv::imread("../img/astronaut.JPG", CV_8U);
+        
+        HOG hog1(16, 8, 8, 9, HOG::GRADIENT_UNSIGNED, HOG::BLOCK_NORM::L2hys);
+        HOG hog2(16, 8, 8, 9, HOG::GRADIENT_UNSIGNED, HOG::BLOCK_NORM::L2hys);
+        hog2.process(image);
+        
+        cv::Mat modified = image.clone();
+        cv::Rect dirty = cv::Rect(50,60,21,13);
+        cv::Mat(modified, dirty).setTo(cv::Scalar(255));
+        
+        hog1.process(modified);
+        hog2.update(modified, dirty);
+        auto hist1 = hog1.retrieve(cv::Rect(0,0,image.cols,image.rows));
+        auto hist2 = hog2.retrieve(cv::Rect(0,0,image.cols,image.rows));
+        for(int i=0; i<hist1.size(); ++i) {
+            if(std::abs(hist1[i]-hist2[i])>1e-4) {
+                std::cout << "Test update failed!\n";  exit(-1);
+            }
+        }
+    }
+    
+    {   // Testing the video mode: only the changed cells are recomputed and 
+        // the result is the same as processing the frame from scratch.
+        
+        // full image
+        cv::Mat frame1 = cv::imread("../img/astronaut.JPG", CV_8U);
+        cv::Mat frame2 = frame1.clone();
+        cv::Mat(frame2, cv::Rect(100,120,30,20)).setTo(cv::Scalar(0));
+        
+        HOG hog(16, 8, 8, 9, HOG::GRADIENT_UNSIGNED, HOG::BLOCK_NORM::L2hys);
+        HOGVideo video(hog);
+        video.process(frame1);
+        video.process(frame2);
+        
+        const HOGVideo::Stats& stats = video.get_stats();
+        if(stats.n_frames != 2 || stats.n_changed_cells == 0 || stats.n_recomputed_cells >= stats.n_cells) {
+            std::cout << "Test video mode stats failed!\n";  exit(-1);
+        }
+        
+        hog.process(frame2);
+        auto hist1 = hog.retrieve(cv::Rect(0,0,frame2.cols,frame2.rows));
+        auto hist2 = video.retrieve(cv::Rect(0,0,frame2.cols,frame2.rows));
+        for(int i=0; i<hist1.size(); ++i) {
+            if(std::abs(hist1[i]-hist2[i])>1e-4) {
+                std::cout << "Test video mode failed!\n";  exit(-1);
+            }
+        }
+    }
+    
+    {   // Testing the asynchronous pipeline: the feature maps must be the same 
+        // as the synchronous ones and the buffers must go back to the pool.
+        
+        // full image
+        cv::Mat image = cv::imread("../img/astronaut.JPG", CV_8U);
+        
+        HOG hog(16, 8, 8, 9, HOG::GRADIENT_UNSIGNED, HOG::BLOCK_NORM::L2hys);
+        hog.process(image);
+        auto hist1 = hog.retrieve(cv::Rect(0,0,image.cols,image.rows));
+        
+        HOGPipeline pipeline(hog, 2);
+        auto future = pipeline.process_async(image);
+        for(int n=0; n<3; ++n) {
+            auto handle = future.get();
+            future = pipeline.process_async(image); // next frame while scoring this one
+            auto hist2 = handle.retrieve(cv::Rect(0,0,image.cols,image.rows));
+            for(int i=0; i<hist1.size(); ++i) {
+                if(std::abs(hist1[i]-hist2[i])>1e-4) {
+                    std::cout << "Test pipeline failed!\n";  exit(-1);
+                }
+            }
+        }
+        future.get().release();
+        if(pipeline.n_free_buffers() != 2) {
+            std::cout << "Test pipeline buffers failed!\n";  exit(-1);
+        }
+    }
+    
+    {   // Testing the executors: the result must not depend on the executor
+        
+        // full image
+        cv::Mat image = cv::imread("../img/astronaut.JPG", CV_8U);
+        
+        HOG hog1(16, 8, 8, 9, HOG::GRADIENT_UNSIGNED, HOG::BLOCK_NORM::L2hys);
+        HOG hog2(16, 8, 8, 9, HOG::GRADIENT_UNSIGNED, HOG::BLOCK_NORM::L2hys);
+        HOG hog3(16, 8, 8, 9, HOG::GRADIENT_UNSIGNED, HOG::BLOCK_NORM::L2hys);
+        hog2.set_executor(std::make_shared<SerialExecutor>());
+        hog3.set_executor(std::make_shared<CallbackExecutor>(
+            [](const size_t begin, const size_t end, const size_t grain, const Executor::Body& body) {
+                #pragma omp parallel for schedule(dynamic)
+                for(int b=begin; b<end; b += grain)
+                    body(b, std::min(b+grain, end));
+            }, 4));
+        
+        hog1.process(image);
+        hog2.process(image);
+        hog3.process(image);
+        auto hist1 = hog1.retrieve(cv::Rect(0,0,image.cols,image.rows));
+        auto hist2 = hog2.retrieve(cv::Rect(0,0,image.cols,image.rows));
+        auto hist3 = hog3.retrieve(cv::Rect(0,0,image.cols,image.rows));
+        for(int i=0; i<hist1.size(); ++i) {
+            if(std::abs(hist1[i]-hist2[i])>1e-4 || std::abs(hist1[i]-hist3[i])>1e-4) {
+                std::cout << "Test executors failed!\n";  exit(-1);
+            }
+        }
+    }
+    
+    #ifdef _OPENMP
+    {   // Testing the work-stealing pool called from an OpenMP parallel region: 
+        // the loops must run on the calling thread (no oversubscription)
+        
+        WorkStealingPool pool(4);
+        std::atomic<int> n_spread(0);
+        #pragma omp parallel num_threads(4)
+        {
+            const std::thread::id id = std::this_thread::get_id();
+            std::atomic<int> n_other(0);
+            pool.parallel_for(0, 64, 1, [&](const size_t begin, const size_t end) {
+                if(std::this_thread::get_id() != id)
+                    n_other++;
+            });
+            if(n_other > 0)
+                n_spread++;
+        }
+        if(n_spread > 0) {
+            std::cout << "Test work-stealing pool in OpenMP region failed!\n";  exit(-1);
+        }
+    }
+    #endif
+    
+    {   // Testing the batch processing with images of different sizes: each 
+        // image must give the same result as HOG::process()
+        
+        // full image
+        cv::Mat image = cv::imread("../img/astronaut.JPG", CV_8U);
+        std::vector<cv::Mat> images = {image, cv::Mat(image, cv::Rect(0,0,64,64)), 
+                                       cv::Mat(image, cv::Rect(40,10,200,100))};
+        
+        HOG hog(16, 8, 8, 9, HOG::GRADIENT_UNSIGNED, HOG::BLOCK_NORM::L2hys);
+        std::vector<HOG> hogs;
+        hog.process_batch(images, hogs);
+        if(hogs.size() != images.size()) {
+            std::cout << "Test batch size failed!\n";  exit(-1);
+        }
+        for(size_t k=0; k<images.size(); ++k) {
+            hog.process(images[k]);
+            auto hist1 = hog.retrieve(cv::Rect(0,0,images[k].cols,images[k].rows));
+            auto hist2 = hogs[k].retrieve(cv::Rect(0,0,images[k].cols,images[k].rows));
+            for(int i=0; i<hist1.size(); ++i) {
+                if(std::abs(hist1[i]-hist2[i])>1e-4) {
+                    std::cout << "Test batch failed!\n";  exit(-1);
+                }
+            }
+        }
+    }
+    
+    {   // Testing the batch scheduling with one very large image and many small
+        // ones: the largest tasks (the bands of the large image) must be picked 
+        // up by different workers, not run one after another by the calling thread
+        
+        // full image
+        cv::Mat image = cv::imread("../img/astronaut.JPG", CV_8U);
+        cv::Mat large;
+        cv::resize(image, large, cv::Size(2048, 2048));
+        std::vector<cv::Mat> images = {large};
+        for(int k=0; k<40; ++k)
+            images.push_back(cv::Mat(image, cv::Rect(k, k, 64, 64)));
+        
+        auto pool = std::make_shared<WorkStealingPool>(4);
+        std::vector<std::thread::id> task_threads;
+        bool first_loop = true;
+        HOG hog(16, 8, 8, 9, HOG::GRADIENT_UNSIGNED, HOG::BLOCK_NORM::L2hys);
+        hog.set_executor(std::make_shared<CallbackExecutor>(
+            [&](const size_t begin, const size_t end, const size_t grain, const Executor::Body& body) {
+                // records the thread of each task of the first loop (the tasks of the batch)
+                const bool record = first_loop;
+                first_loop = false;
+                if(record)
+                    task_threads.resize(end);
+                pool->parallel_for(begin, end, grain, [&](const size_t b, const size_t e) {
+                    if(record)
+                        for(size_t t=b; t<e; ++t)
+                            task_threads[t] = std::this_thread::get_id();
+                    body(b, e);
+                });
+            }, pool->concurrency()));
+        std::vector<HOG> hogs;
+        hog.process_batch(images, hogs);
+        
+        const size_t n_largest = std::min<size_t>(pool->concurrency(), task_threads.size());
+        std::vector<std::thread::id> largest(task_threads.begin(), task_threads.begin()+n_largest);
+        std::sort(largest.begin(), largest.end());
+        if(task_threads.size() <= images.size() || 
+           std::unique(largest.begin(), largest.end()) - largest.begin() < 2) {
+            std::cout << "Test batch scheduling failed!\n";  exit(-1);
+        }
+    }
+    
+    {   // Testing the anytime detector: with enough time all the windows are 
+        // scored, with no time (or cancelled) the search stops immediately.
+        
+        // full image
+        cv::Mat image = cv::imread("../img/astronaut.JPG", CV_8U);
+        
+        HOG hog(16, 8, 8, 9, HOG::GRADIENT_UNSIGNED, HOG::BLOCK_NORM::L2hys);
+        cv::Size window(64,128);
+        HOG::THist weights(hog.descriptor_size(window), 0.01);
+        AnytimeDetector detector(hog, window, weights, -1.0);
+        
+        auto result1 = detector.detect(image, std::chrono::seconds(60));
+        if(!result1.completed || result1.n_windows_evaluated != result1.n_windows_total || result1.coverage != 1) {
+            std::cout << "Test anytime detector (complete) failed!\n";  exit(-1);
+        }
+        for(size_t i=1; i<result1.detections.size(); ++i) {
+            if(result1.detections[i].score > result1.detections[i-1].score) {
+                std::cout << "Test anytime detector (order) failed!\n";  exit(-1);
+            }
+        }
+        
+        auto result2 = detector.detect(image, std::chrono::seconds(0));
+        if(result2.completed || result2.n_windows_evaluated != 0) {
+            std::cout << "Test anytime detector (deadline) failed!\n";  exit(-1);
+        }
+        
+        CancellationToken token;
+        token.cancel();
+        auto result3 = detector.detect(image, std::chrono::seconds(60), token);
+        if(result3.completed || result3.coverage != 0) {
+            std::cout << "Test anytime detector (cancel) failed!\n";  exit(-1);
+        }
+    }
+    
+    {   // Testing the cancellation and the progress of HOG::process()
+        
+        // full image
+        cv::Mat image = cv::imread("../img/astronaut.JPG", CV_8U);
+        
+        HOG hog(16, 8, 8, 9, HOG::GRADIENT_UNSIGNED, HOG::BLOCK_NORM::L2hys);
+        float last_progress = 0;
+        hog.process(image, CancellationToken(), [&](const float p) { last_progress = p; });
+        if(std::abs(last_progress-1) > 1e-6) {
+            std::cout << "Test progress failed!\n";  exit(-1);
+        }
+        
+        CancellationToken token;
+        token.cancel();
+        try {
+            hog.process(image, token);
+            std::cout << "Test cancellation failed!\n";  exit(-1);
+        } catch(const OperationCancelled&) { }
+        try {
+            std::vector<HOG> hogs;
+            hog.process_batch({image, image}, hogs, token);
+            std::cout << "Test batch cancellation failed!\n";  exit(-1);
+        } catch(const OperationCancelled&) { }
+        
+        // the other long computations: ROIs, update, bank and integral histograms
+        const std::vector<cv::Rect> rois = {cv::Rect(16, 24, 64, 128)};
+        HOGBank bank({HOG(16, 8, 8, 9, HOG::GRADIENT_UNSIGNED), HOG(32, 16, 16, 18, HOG::GRADIENT_SIGNED)});
+        IntegralHOG ihog(9, HOG::GRADIENT_UNSIGNED, HOG::BLOCK_NORM::L1norm);
+        std::vector<std::function<void(const CancellationToken&, const ProgressCallback&)>> computations = {
+            [&](const CancellationToken& t, const ProgressCallback& p) { hog.process(image, rois, t, p); },
+            [&](const CancellationToken& t, const ProgressCallback& p) { hog.process(image); hog.update(image, rois, t, p); },
+            [&](const CancellationToken& t, const ProgressCallback& p) { bank.process(image, t, p); },
+            [&](const CancellationToken& t, const ProgressCallback& p) { ihog.process(image, t, p); }
+        };
+        for(const auto& computation : computations) {
+            last_progress = 0;
+            computation(CancellationToken(), [&](const float p) { last_progress = p; });
+            if(std::abs(last_progress-1) > 1e-4) {
+                std::cout << "Test progress (other computations) failed!\n";  exit(-1);
+            }
+            try {
+                computation(token, nullptr);
+                std::cout << "Test cancellation (other computations) failed!\n";  exit(-1);
+            } catch(const OperationCancelled&) { }
+        }
+    }
+    
+    {   // Testing the energy map: the energy of a window is the sum of the 
+        // cell histograms and the enumeration keeps only the windows above the threshold
+        
+        // full image
+        cv::Mat image = cv::imread("../img/astronaut.JPG", CV_8U);
+        
+        HOG hog(16, 8, 8, 9, HOG::GRADIENT_UNSIGNED, HOG::BLOCK_NORM::L2hys);
+        hog.set_energy_map(true);
+        hog.process(image);
+        
+        cv::Size window(64,128);
+        cv::Rect roi(40, 80, window.width, window.height);
+        double expected = 0;
+        for(int y = roi.y/8; y < (roi.y+roi.height)/8; ++y)
+            for(int x = roi.x/8; x < (roi.x+roi.width)/8; ++x)
+                expected += cv::sum(hog.get_magnitudes()(cv::Rect(x*8, y*8, 8, 8)))[0];
+        if(std::abs(hog.window_energy(roi)-expected) > 1e-3*expected) {
+            std::cout << "Test energy map (window) failed!\n";  exit(-1);
+        }
+        
+        // the enumeration is checked against the energies summed directly from the 
+        // cell histograms, the windows of the last column and row included
+        cv::Mat cell_energy;
+        for(const auto& plane : hog.get_cell_map())
+            cell_energy = cell_energy.empty() ? plane.clone() : cell_energy + plane;
+        auto energy_from_cells = [&](const cv::Rect& r) {
+            return cv::sum(cell_energy(cv::Rect(r.x/8, r.y/8, r.width/8, r.height/8)))[0];
+        };
+        const float threshold = hog.window_energy(roi);
+        auto windows = hog.windows_above_energy(window, 8, threshold);
+        if(std::find(windows.begin(), windows.end(), roi) == windows.end()) {
+            std::cout << "Test energy map (threshold) failed!\n";  exit(-1);
+        }
+        for(int y = 0; y <= image.rows-window.height; y += 8) {
+            for(int x = 0; x <= image.cols-window.width; x += 8) {
+                const cv::Rect r(x, y, window.width, window.height);
+                const double energy = energy_from_cells(r);
+                const bool listed = std::find(windows.begin(), windows.end(), r) != windows.end();
+                if(std::abs(energy-threshold) > 1e-4*threshold && listed != (energy >= threshold)) {
+                    std::cout << "Test energy map (enumeration) failed!\n";  exit(-1);
+                }
+            }
+        }
+        
+        // after an update the energies are the ones of the modified image
+        cv::Mat modified = image.clone();
+        modified(cv::Rect(200, 150, 40, 30)).setTo(cv::Scalar(255));
+        hog.update(modified, cv::Rect(200, 150, 40, 30));
+        HOG fresh_hog(16, 8, 8, 9, HOG::GRADIENT_UNSIGNED, HOG::BLOCK_NORM::L2hys);
+        fresh_hog.set_energy_map(true);
+        fresh_hog.process(modified);
+        for(const auto& r : {cv::Rect(0, 0, 64, 128), cv::Rect(176, 120, 64, 128), 
+                             cv::Rect(image.cols/8*8-64, image.rows/8*8-128, 64, 128)}) {
+            if(std::abs(hog.window_energy(r)-fresh_hog.window_energy(r)) > 1e-3*fresh_hog.window_energy(r)) {
+                std::cout << "Test energy map (update) failed!\n";  exit(-1);
+            }
+        }
+        
+        HOG lazy_hog(16, 8, 8, 9, HOG::GRADIENT_UNSIGNED, HOG::BLOCK_NORM::L2hys);
+        lazy_hog.set_lazy(true);
+        lazy_hog.set_energy_map(true);
+        lazy_hog.process(image);
+        try {
+            lazy_hog.window_energy(roi);
+            std::cout << "Test energy map (lazy) failed!\n";  exit(-1);
+        } catch(const std::runtime_error&) { }
+        
+        // ROI mode: the windows outside of the processed area are rejected as by 
+        // HOG::retrieve() and never enumerated
+        HOG roi_hog(16, 8, 8, 9, HOG::GRADIENT_UNSIGNED, HOG::BLOCK_NORM::L2hys);
+        roi_hog.set_energy_map(true);
+        roi_hog.process(image, {roi});
+        if(std::abs(roi_hog.window_energy(roi)-expected) > 1e-3*expected) {
+            std::cout << "Test energy map (ROI window) failed!\n";  exit(-1);
+        }
+        try {
+            roi_hog.window_energy(cv::Rect(roi.x+64, roi.y, window.width, window.height));
+            std::cout << "Test energy map (outside of the ROIs) failed!\n";  exit(-1);
+        } catch(const std::runtime_error&) { }
+        auto roi_windows = roi_hog.windows_above_energy(window, 8, 0);
+        if(roi_windows.size() != 1 || roi_windows[0] != roi) {
+            std::cout << "Test energy map (ROI enumeration) failed!\n";  exit(-1);
+        }
+    }
+    
+    {   // Testing the cascade detector: without rejection the scores are the 
+        // ones of the full model, with rejection only the first stage is normalized
+        
+        // full image
+        cv::Mat image = cv::imread("../img/astronaut.JPG", CV_8U);
+        
+        HOG hog(16, 8, 8, 9, HOG::GRADIENT_UNSIGNED, HOG::BLOCK_NORM::L2hys);
+        cv::Size window(64,128);
+        cv::Rect roi(40, 80, window.width, window.height);
+        hog.process(image);
+        auto hist = hog.retrieve(roi);
+        HOG::THist block_hist;
+        hog.retrieve_block(roi, 5, block_hist);
+        if(!std::equal(std::begin(block_hist), std::end(block_hist), std::begin(hist) + 5*hog.get_block_hist_size())) {
+            std::cout << "Test retrieve block failed!\n";  exit(-1);
+        }
+        
+        HOG::THist weights(hog.descriptor_size(window));
+        for(size_t i=0; i<weights.size(); ++i)
+            weights[i] = (i%7 == 0) ? 0.05 : -0.01;
+        
+        CascadeDetector cascade(hog, window, weights, 0.5, -1e9);
+        cascade.add_stage({0, 1, 2, 3}, -1e9);
+        auto detections = cascade.detect(image);
+        float score = 0;
+        if(cascade.score(roi, score) != 1 || std::abs(score - std::inner_product(std::begin(hist), std::end(hist), std::begin(weights), 0.5f)) > 1e-3) {
+            std::cout << "Test cascade detector (score) failed!\n";  exit(-1);
+        }
+        const auto stats1 = cascade.get_stats();
+        if(detections.size() != stats1.n_windows || stats1.n_blocks_normalized != stats1.n_windows*hog.n_blocks(window)) {
+            std::cout << "Test cascade detector (no rejection) failed!\n";  exit(-1);
+        }
+        
+        CascadeDetector strict(hog, window, weights, 0.5, -1e9);
+        strict.add_stage({0, 1, 2, 3}, 1e9);
+        detections = strict.detect(image);
+        const auto stats2 = strict.get_stats();
+        if(!detections.empty() || stats2.n_rejected[0] != stats2.n_windows || stats2.n_blocks_normalized != 4*stats2.n_windows) {
+            std::cout << "Test cascade detector (rejection) failed!\n";  exit(-1);
+        }
+    }
+    
+    {   // Testing the integral histograms: a 2x2 block of 8x8 cells is equal 
+        // to the corresponding block of the HOG, blocks of any size can be retrieved
+        
+        // full image
+        cv::Mat image = cv::imread("../img/astronaut.JPG", CV_8U);
+        
+        HOG hog(16, 8, 8, 9, HOG::GRADIENT_UNSIGNED, HOG::BLOCK_NORM::none);
+        hog.process(image);
+        IntegralHOG ihog(9, HOG::GRADIENT_UNSIGNED, HOG::BLOCK_NORM::none);
+        ihog.process(image);
+        
+        cv::Rect window(40, 80, 64, 128);
+        auto hist = hog.retrieve(cv::Rect(window.x+16, window.y+32, 16, 16));
+        IntegralHOG::Block block;
+        block.rect = cv::Rect(16, 32, 16, 16);
+        auto ihist = ihog.retrieve(window, {block});
+        if(hist.size() != ihist.size()) {
+            std::cout << "Test integral HOG (size) failed!\n";  exit(-1);
+        }
+        for(size_t i=0; i<hist.size(); ++i) {
+            if(std::abs(hist[i]-ihist[i]) > 1e-3*std::max<float>(1, hist[i])) {
+                std::cout << "Test integral HOG (values) failed!\n";  exit(-1);
+            }
+        }
+        
+        IntegralHOG ihog_l2(9, HOG::GRADIENT_UNSIGNED, HOG::BLOCK_NORM::L2norm);
+        ihog_l2.process(image);
+        IntegralHOG::Block wide;
+        wide.rect = cv::Rect(4, 10, 48, 20);
+        wide.n_cells_y = 1;
+        wide.n_cells_x = 3;
+        auto features = ihog_l2.retrieve(window, {block, wide});
+        if(features.size() != ihog_l2.descriptor_size({block, wide}) || features.size() != (4+3)*9) {
+            std::cout << "Test integral HOG (variable blocks) failed!\n";  exit(-1);
+        }
+        
+        // the images whose integral histograms exceed the memory limit are rejected
+        if(ihog.memory_size(image.size()) != (image.rows+1)*(image.cols+1)*9*sizeof(double)) {
+            std::cout << "Test integral HOG (memory size) failed!\n";  exit(-1);
+        }
+        ihog.set_max_memory(ihog.memory_size(image.size()) - 1);
+        try {
+            ihog.process(image);
+            std::cout << "Test integral HOG (memory limit) failed!\n";  exit(-1);
+        } catch(const std::runtime_error&) { }
+    }
+    
+    {   // Testing the correlation in the Fourier domain: the response is equal
+        // to the direct correlation of the template with the map of cells
+        
+        // full image
+        cv::Mat image = cv::imread("../img/astronaut.JPG", CV_8U);
+        
+        HOG hog(16, 8, 8, 9, HOG::GRADIENT_UNSIGNED, HOG::BLOCK_NORM::L2hys);
+        hog.process(image);
+        auto map = hog.get_cell_map();
+        
+        std::vector<cv::Mat> templ;
+        cv::Rect templ_rect(7, 5, 8, 16);
+        for(const auto& plane : map)
+            templ.push_back(plane(templ_rect).clone());
+        
+        HOGCorrelator correlator;
+        correlator.set_template(templ);
+        for(int run = 0; run < 2; ++run) {  // the 2nd run uses the cached spectra
+            cv::Mat response = correlator.correlate(map);
+            if(response.rows != map[0].rows-templ_rect.height+1 || response.cols != map[0].cols-templ_rect.width+1) {
+                std::cout << "Test correlation (size) failed!\n";  exit(-1);
+            }
+            for(const auto& offset : {cv::Point(0,0), cv::Point(templ_rect.x,templ_rect.y), cv::Point(response.cols-1,response.rows-1)}) {
+                double expected = 0;
+                for(size_t c = 0; c < map.size(); ++c)
+                    expected += cv::sum(map[c](cv::Rect(offset.x, offset.y, templ_rect.width, templ_rect.height)).mul(templ[c]))[0];
+                if(std::abs(response.at<float>(offset.y, offset.x) - expected) > 1e-3*std::max(1.0, std::abs(expected))) {
+                    std::cout << "Test correlation (values) failed!\n";  exit(-1);
+                }
+            }
+        }
+    }
+    
+    {   // Testing the deformable part model: the distance transform is equal to
+        // the brute-force search of the best displacement
+        
+        cv::Mat response(12, 17, CV_32F);
+        cv::randu(response, -5, 5);
+        cv::Vec4f deformation(0.3, 0.5, -0.2, 0.8);
+        cv::Mat out, best_x, best_y;
+        DPMDetector::distance_transform(response, deformation, out, best_x, best_y);
+        for(int y=0; y<response.rows; ++y) {
+            for(int x=0; x<response.cols; ++x) {
+                float best = -1e30;
+                for(int yy=0; yy<response.rows; ++yy) {
+                    for(int xx=0; xx<response.cols; ++xx) {
+                        const float dx = xx-x, dy = yy-y;
+                        best = std::max(best, response.at<float>(yy,xx) - deformation[0]*dx - deformation[1]*dx*dx 
+                                                                         - deformation[2]*dy - deformation[3]*dy*dy);
+                    }
+                }
+                const float dx = best_x.at<int>(y,x)-x, dy = best_y.at<int>(y,x)-y;
+                const float placed = response.at<float>(best_y.at<int>(y,x), best_x.at<int>(y,x)) - deformation[0]*dx 
+                                   - deformation[1]*dx*dx - deformation[2]*dy - deformation[3]*dy*dy;
+                if(std::abs(out.at<float>(y,x)-best) > 1e-3 || std::abs(placed-best) > 1e-3) {
+                    std::cout << "Test distance transform failed!\n";  exit(-1);
+                }
+            }
+        }
+        
+        // full image
+        cv::Mat image = cv::imread("../img/astronaut.JPG", CV_8U);
+        
+        HOG hog(16, 8, 8, 9, HOG::GRADIENT_UNSIGNED, HOG::BLOCK_NORM::L2hys);
+        DPMModel model;
+        for(size_t c=0; c<9; ++c)
+            model.root.push_back(cv::Mat(8, 4, CV_32F, cv::Scalar(0.01)));
+        DPMPart part;
+        for(size_t c=0; c<9; ++c)
+            part.filter.push_back(cv::Mat(4, 4, CV_32F, cv::Scalar(0.01)));
+        part.anchor = cv::Point(2, 2);
+        part.deformation = cv::Vec4f(0, 0.1, 0, 0.1);
+        model.parts.push_back(part);
+        model.bias = -1;
+        DPMDetector detector(hog, model, 3, -1e9);
+        auto detections = detector.detect(image);
+        if(detections.empty()) {
+            std::cout << "Test DPM detector (detections) failed!\n";  exit(-1);
+        }
+        for(size_t i=0; i<detections.size(); ++i) {
+            if((i > 0 && detections[i].score > detections[i-1].score) || detections[i].parts.size() != 1) {
+                std::cout << "Test DPM detector (order) failed!\n";  exit(-1);
+            }
+        }
+    }
+    
+    {   // Testing the FHOG features: 31 channels of the inner cells, bounded by 
+        // the truncation, and a single signed gradient pass whatever the binning
+        
+        // full image
+        cv::Mat image = cv::imread("../img/astronaut.JPG", CV_8U);
+        
+        HOG hog(16, 8, 8, 9, HOG::GRADIENT_UNSIGNED, HOG::BLOCK_NORM::L2hys);
+        hog.process(image);
+        auto fhog = hog.get_fhog();
+        const int rows = image.rows/8 - 2;
+        const int cols = image.cols/8 - 2;
+        if(fhog.size() != 31 || fhog[0].rows != rows || fhog[0].cols != cols) {
+            std::cout << "Test FHOG (size) failed!\n";  exit(-1);
+        }
+        for(size_t k=0; k<fhog.size(); ++k) {
+            double min_value, max_value;
+            cv::minMaxLoc(fhog[k], &min_value, &max_value);
+            if(min_value < 0 || max_value > (k < 27 ? 0.4 : 4*18*0.2*0.2357) + 1e-5) {
+                std::cout << "Test FHOG (range) failed!\n";  exit(-1);
+            }
+        }
+        
+        HOG hog_signed(32, 8, 8, 12, HOG::GRADIENT_SIGNED, HOG::BLOCK_NORM::L1norm);
+        hog_signed.set_lazy(true);
+        hog_signed.process(image);
+        auto fhog_signed = hog_signed.get_fhog();
+        for(size_t k=0; k<fhog.size(); ++k) {
+            if(cv::norm(fhog[k], fhog_signed[k], cv::NORM_INF) > 1e-5) {
+                std::cout << "Test FHOG (configuration) failed!\n";  exit(-1);
+            }
+        }
+    }
+    
+    {   // Testing the multi-model detector: the scores of every model are the 
+        // ones of HOG::retrieve() with the model alone
+        
+        // full image
+        cv::Mat image = cv::imread("../img/astronaut.JPG", CV_8U);
+        
+        HOG hog(16, 8, 8, 9, HOG::GRADIENT_UNSIGNED, HOG::BLOCK_NORM::L2hys);
+        cv::Size window(64,128);
+        std::vector<HOG::THist> weights(3, HOG::THist(hog.descriptor_size(window)));
+        for(size_t k=0; k<weights.size(); ++k)
+            for(size_t i=0; i<weights[k].size(); ++i)
+                weights[k][i] = ((i+k)%5 == 0) ? 0.03 : -0.01;
+        MultiModelDetector detector(hog, window, weights, {0.1f, -0.2f, 0.3f}, {-1e9f, -1e9f, 0.0f});
+        detector.set_window_stride(16);
+        auto detections = detector.detect(image);
+        
+        hog.process(image);
+        const size_t n_windows = ((image.rows-window.height)/16 + 1)*((image.cols-window.width)/16 + 1);
+        if(detections.size() != 3 || detections[0].size() != n_windows || detections[1].size() != n_windows) {
+            std::cout << "Test multi-model detector (detections) failed!\n";  exit(-1);
+        }
+        const float biases[3] = {0.1f, -0.2f, 0.3f};
+        for(size_t k=0; k<detections.size(); ++k) {
+            for(size_t i=0; i<std::min<size_t>(detections[k].size(), 20); ++i) {
+                auto hist = hog.retrieve(detections[k][i].rect);
+                const float score = std::inner_product(std::begin(hist), std::end(hist), std::begin(weights[k]), biases[k]);
+                if(std::abs(score - detections[k][i].score) > 1e-3 || (k == 2 && score <= 0)) {
+                    std::cout << "Test multi-model detector (scores) failed!\n";  exit(-1);
+                }
+            }
+        }
+    }
+    
+    {   // Testing the retrieval of many windows: same histograms as HOG::retrieve()
+        
+        // full image
+        cv::Mat image = cv::imread("../img/astronaut.JPG", CV_8U);
+        
+        HOG hog(16, 8, 8, 9, HOG::GRADIENT_UNSIGNED, HOG::BLOCK_NORM::L2hys);
+        hog.process(image);
+        std::vector<cv::Rect> windows;
+        for(int k=0; k<200; ++k) {
+            const int width = 16 + 8*(k%7);
+            const int height = 16 + 8*(k%11);
+            windows.push_back(cv::Rect((k*37)%(image.cols-width), (k*53)%(image.rows-height), width, height));
+        }
+        auto hists = hog.retrieve_many(windows);
+        if(hists.size() != windows.size()) {
+            std::cout << "Test retrieve many (size) failed!\n";  exit(-1);
+        }
+        for(size_t k=0; k<windows.size(); ++k) {
+            if(hists[k] != hog.retrieve(windows[k])) {
+                std::cout << "Test retrieve many (values) failed!\n";  exit(-1);
+            }
+        }
+    }
+    
+    {   // Testing the norms of the blocks from the summed-area table of the cell 
+        // norms: same result as the normalization of the raw blocks
+        
+        // full image
+        cv::Mat image = cv::imread("../img/astronaut.JPG", CV_8U);
+        
+        HOG raw(16, 8, 8, 9, HOG::GRADIENT_UNSIGNED, HOG::BLOCK_NORM::none);
+        raw.process(image);
+        cv::Rect window(40, 80, 64, 128);
+        auto raw_hist = raw.retrieve(window);
+        for(auto norm : {HOG::BLOCK_NORM::L2norm, HOG::BLOCK_NORM::L2hys}) {
+            HOG hog(16, 8, 8, 9, HOG::GRADIENT_UNSIGNED, norm);
+            hog.process(image);
+            auto hist = hog.retrieve(window);
+            HOG lazy_hog(16, 8, 8, 9, HOG::GRADIENT_UNSIGNED, norm);
+            lazy_hog.set_lazy(true);
+            lazy_hog.process(image);
+            auto lazy_hist = lazy_hog.retrieve(window);
+            const size_t block_size = hog.get_block_hist_size();
+            for(size_t b=0; b<hist.size()/block_size; ++b) {
+                HOG::THist block(raw_hist.begin()+b*block_size, raw_hist.begin()+(b+1)*block_size);
+                if(norm == HOG::BLOCK_NORM::L2norm)
+                    HOG::L2norm(block);
+                else
+                    HOG::L2hys(block);
+                for(size_t i=0; i<block_size; ++i) {
+                    if(std::abs(block[i]-hist[b*block_size+i]) > 1e-4 || std::abs(lazy_hist[b*block_size+i]-hist[b*block_size+i]) > 1e-4) {
+                        std::cout << "Test cell-norm integral failed!\n";  exit(-1);
+                    }
+                }
+            }
+            
+            // after an update of several regions (only the bottom-right part of the 
+            // table is recomputed) the norms are the ones of the modified image
+            cv::Mat modified = image.clone();
+            const std::vector<cv::Rect> dirty = {cv::Rect(300, 200, 30, 20), cv::Rect(120, 350, 16, 40)};
+            for(const auto& d : dirty)
+                modified(d).setTo(cv::Scalar(0));
+            hog.update(modified, dirty);
+            HOG fresh_hog(16, 8, 8, 9, HOG::GRADIENT_UNSIGNED, norm);
+            fresh_hog.process(modified);
+            const cv::Rect whole(0, 0, image.cols, image.rows);
+            auto updated_hist = hog.retrieve(whole);
+            auto fresh_hist = fresh_hog.retrieve(whole);
+            for(size_t i=0; i<fresh_hist.size(); ++i) {
+                if(std::abs(updated_hist[i]-fresh_hist[i]) > 1e-4) {
+                    std::cout << "Test cell-norm integral (update) failed!\n";  exit(-1);
+                }
+            }
+        }
+    }
+    
+    {   // Testing the keypoint descriptors: on integer positions they are equal
+        // to the blocks of the integral HOG, in between they are interpolated
+        
+        // full image
+        cv::Mat image = cv::imread("../img/astronaut.JPG", CV_8U);
+        
+        IntegralHOG ihog(9, HOG::GRADIENT_UNSIGNED, HOG::BLOCK_NORM::L2norm);
+        ihog.process(image);
+        std::vector<cv::Point2f> points;
+        for(int k=0; k<1000; ++k)
+            points.push_back(cv::Point2f(20 + (k*37)%(image.cols-40), 20 + (k*53)%(image.rows-40)));
+        points.push_back(cv::Point2f(100.5f, 120.25f));
+        points.push_back(cv::Point2f(-5.0f, 3.0f));
+        cv::Mat descriptors = ihog.describe_points(points, 16, 4);
+        if(descriptors.rows != static_cast<int>(points.size()) || descriptors.cols != 4*4*9) {
+            std::cout << "Test keypoints (size) failed!\n";  exit(-1);
+        }
+        IntegralHOG::Block block;
+        block.rect = cv::Rect(0, 0, 16, 16);
+        block.n_cells_y = 4;
+        block.n_cells_x = 4;
+        for(size_t k=0; k<1000; k += 97) {
+            auto hist = ihog.retrieve(cv::Rect(points[k].x-8, points[k].y-8, 16, 16), {block});
+            for(int i=0; i<descriptors.cols; ++i) {
+                if(std::abs(hist[i] - descriptors.at<float>(k, i)) > 1e-4) {
+                    std::cout << "Test keypoints (values) failed!\n";  exit(-1);
+                }
+            }
+        }
+        
+        // sub-pixel and partly outside patches (without normalization): the bilinear 
+        // interpolation of the integral histograms weights each pixel by the area 
+        // covered by the cell, the cells being clipped to the image
+        IntegralHOG raw_ihog(9, HOG::GRADIENT_UNSIGNED, HOG::BLOCK_NORM::none);
+        raw_ihog.process(image);
+        cv::Mat Dx, Dy, mag, ori;
+        cv::filter2D(image, Dx, CV_32F, (cv::Mat_<char>(1, 3) << -1, 0, 1));
+        cv::filter2D(image, Dy, CV_32F, (cv::Mat_<char>(3, 1) << -1, 0, 1));
+        cv::magnitude(Dx, Dy, mag);
+        cv::phase(Dx, Dy, ori, true);
+        const std::vector<cv::Point2f> subpixel = {cv::Point2f(100.5f, 120.25f), cv::Point2f(-5.0f, 3.0f), 
+                                                   cv::Point2f(image.cols-2.75f, image.rows-6.5f)};
+        cv::Mat raw_descriptors = raw_ihog.describe_points(subpixel, 16, 4);
+        auto clip = [](const float v, const int size) { return std::min(std::max(v, 0.0f), static_cast<float>(size)); };
+        for(size_t p=0; p<subpixel.size(); ++p) {
+            for(int i=0; i<4; ++i) {
+                for(int j=0; j<4; ++j) {
+                    const float y0 = clip(subpixel[p].y - 8 + 4*i, image.rows), y1 = clip(subpixel[p].y - 8 + 4*(i+1), image.rows);
+                    const float x0 = clip(subpixel[p].x - 8 + 4*j, image.cols), x1 = clip(subpixel[p].x - 8 + 4*(j+1), image.cols);
+                    std::vector<double> expected(9, 0);
+                    for(int r = static_cast<int>(std::floor(y0)); r < std::ceil(y1); ++r) {
+                        for(int c = static_cast<int>(std::floor(x0)); c < std::ceil(x1); ++c) {
+                            const double area = (std::min<double>(y1, r+1) - std::max<double>(y0, r))
+                                              * (std::min<double>(x1, c+1) - std::max<double>(x0, c));
+                            float orientation = ori.at<float>(r, c);
+                            if(orientation >= 180)
+                                orientation -= 180;
+                            const size_t bin = std::min(static_cast<size_t>(orientation / 20.0f), size_t(8));
+                            expected[bin] += area*mag.at<float>(r, c);
+                        }
+                    }
+                    for(int k=0; k<9; ++k) {
+                        const float value = raw_descriptors.at<float>(p, (i*4 + j)*9 + k);
+                        if(std::abs(value - expected[k]) > 1e-3*std::max(1.0, expected[k])) {
+                            std::cout << "Test keypoints (sub-pixel and clipped values) failed!\n";  exit(-1);
+                        }
+                    }
+                }
+            }
+        }
+    }
+    
+    {   // Testing the rotation normalization: a patch and the same patch turned 
+        // by 90° have the same descriptor
+        
+        // full image
+        cv::Mat image = cv::imread("../img/astronaut.JPG", CV_8U);
+        cv::Mat patch = image(cv::Rect(100, 60, 64, 64)).clone();
+        cv::Mat turned;
+        cv::transpose(patch, turned);
+        cv::flip(turned, turned, 1);   // clockwise
+        
+        HOG hog(16, 8, 8, 8, HOG::GRADIENT_SIGNED, HOG::BLOCK_NORM::L2hys);
+        hog.set_rotation_normalization(true);
+        hog.process(patch);
+        auto hist1 = hog.retrieve(cv::Rect(0, 0, 64, 64));
+        hog.process(turned);
+        auto hist2 = hog.retrieve(cv::Rect(0, 0, 64, 64));
+        float diff = 0, total = 0;
+        for(size_t i=0; i<hist1.size(); ++i) {
+            diff += std::abs(hist1[i]-hist2[i]);
+            total += hist1[i];
+        }
+        if(hist1.size() != hist2.size() || diff > 0.05*total) {
+            std::cout << "Test rotation normalization failed!\n";  exit(-1);
+        }
+        
+        // the other retrievals of a window honor the rotation (or throw)
+        const cv::Rect window(0, 0, 64, 64);
+        auto many = hog.retrieve_many({window});
+        auto resampled = hog.retrieve_resampled(window, 8, 8);
+        if(many[0] != hist2 || resampled.size() != hist2.size()) {
+            std::cout << "Test rotation normalization (other retrievals) failed!\n";  exit(-1);
+        }
+        for(size_t i=0; i<hist2.size(); ++i) {
+            if(std::abs(resampled[i]-hist2[i]) > 1e-4) {
+                std::cout << "Test rotation normalization (resampled) failed!\n";  exit(-1);
+            }
+        }
+        try {
+            HOG::THist block_hist;
+            hog.retrieve_block(window, 0, block_hist);
+            std::cout << "Test rotation normalization (block) failed!\n";  exit(-1);
+        } catch(const std::runtime_error&) { }
+        try {
+            hog.get_block_map();
+            std::cout << "Test rotation normalization (block map) failed!\n";  exit(-1);
+        } catch(const std::runtime_error&) { }
+        
+        // 9 signed bins of 40°: 90° isn't a whole number of bins, only the bins are
+        // shifted and the grid is not turned
+        HOG plain(16, 8, 8, 9, HOG::GRADIENT_SIGNED, HOG::BLOCK_NORM::none);
+        HOG rotated(16, 8, 8, 9, HOG::GRADIENT_SIGNED, HOG::BLOCK_NORM::none);
+        rotated.set_rotation_normalization(true);
+        plain.process(patch);
+        rotated.process(patch);
+        auto plain_hist = plain.retrieve(window);
+        auto rotated_hist = rotated.retrieve(window);
+        auto map = plain.get_cell_map();
+        std::vector<double> window_hist(9);
+        for(int b=0; b<9; ++b)
+            window_hist[b] = cv::sum(map[b])[0];
+        const size_t dominant = std::max_element(window_hist.begin(), window_hist.end()) - window_hist.begin();
+        for(size_t c=0; c<plain_hist.size()/9; ++c) {
+            for(size_t b=0; b<9; ++b) {
+                if(std::abs(rotated_hist[c*9+b] - plain_hist[c*9+(b+dominant)%9]) > 1e-4) {
+                    std::cout << "Test rotation normalization (9 signed bins) failed!\n";  exit(-1);
+                }
+            }
+        }
+    }
+    
+    {   // Testing the resampled retrieval: on its own grid it is HOG::retrieve(),
+        // windows of any size give descriptors of the same length
+        
+        // full image
+        cv::Mat image = cv::imread("../img/astronaut.JPG", CV_8U);
+        
+        HOG hog(16, 8, 8, 9, HOG::GRADIENT_UNSIGNED, HOG::BLOCK_NORM::L2hys);
+        hog.process(image);
+        cv::Rect window(40, 80, 64, 128);
+        auto hist1 = hog.retrieve(window);
+        auto hist2 = hog.retrieve_resampled(window, 16, 8);
+        if(hist1.size() != hist2.size()) {
+            std::cout << "Test resampled retrieve (size) failed!\n";  exit(-1);
+        }
+        for(size_t i=0; i<hist1.size(); ++i) {
+            if(std::abs(hist1[i]-hist2[i]) > 1e-4) {
+                std::cout << "Test resampled retrieve (values) failed!\n";  exit(-1);
+            }
+        }
+        for(const auto& rect : {cv::Rect(0, 0, 48, 80), cv::Rect(16, 24, 200, 312), cv::Rect(3, 5, 77, 150)}) {
+            if(hog.retrieve_resampled(rect, 16, 8).size() != hog.descriptor_size(cv::Size(64,128))) {
+                std::cout << "Test resampled retrieve (length) failed!\n";  exit(-1);
+            }
+        }
+    }
+    
+    {   // Testing the kernels of every instruction set supported by the CPU:
+        // same results as the generic ones, the sums within the documented 1e-4
+        
+        const HOGKernels& generic = *find_hog_kernels("generic");
+        std::vector<float> v(1000);
+        for(size_t i=0; i<v.size(); ++i)
+            v[i] = (i*7919)%3600/10.0f;
+        v.back() = 360.0f;
+        for(const auto& name : supported_hog_kernels()) {
+            const HOGKernels& kernels = *find_hog_kernels(name);
+            for(size_t n : {0, 3, 9, 36, 999, 1000}) {
+                std::vector<float> a(n), b(n);
+                std::vector<int> bins_a(n), bins_b(n);
+                bool ok = std::abs(kernels.sum(v.data(), n) - generic.sum(v.data(), n)) <= 1e-4*generic.sum(v.data(), n)
+                       && std::abs(kernels.sum_of_squares(v.data(), n) - generic.sum_of_squares(v.data(), n)) <= 1e-4*generic.sum_of_squares(v.data(), n);
+                kernels.scale(v.data(), a.data(), n, 0.3f);
+                generic.scale(v.data(), b.data(), n, 0.3f);
+                ok = ok && a == b;
+                std::copy(v.begin(), v.begin()+n, a.begin());
+                std::copy(v.begin(), v.begin()+n, b.begin());
+                kernels.clip(a.data(), n, 10.0f, 200.0f);
+                generic.clip(b.data(), n, 10.0f, 200.0f);
+                ok = ok && a == b;
+                kernels.bin_indices(v.data(), bins_a.data(), n, 20.0f, 180.0f, 8);
+                generic.bin_indices(v.data(), bins_b.data(), n, 20.0f, 180.0f, 8);
+                ok = ok && bins_a == bins_b;
+                if(!ok) {
+                    std::cout << "Test kernels (" << name << ") failed!\n";  exit(-1);
+                }
+            }
+        }
+    }
+    
+    {   // Testing the memory layouts: padded blocks and channels first hold the
+        // same values as HOG::retrieve()
+        
+        // full image
+        cv::Mat image = cv::imread("../img/astronaut.JPG", CV_8U);
+        
+        HOG hog(16, 8, 8, 9, HOG::GRADIENT_UNSIGNED, HOG::BLOCK_NORM::L2hys);
+        hog.process(image);
+        cv::Rect window(40, 80, 64, 128);
+        auto hist = hog.retrieve(window);
+        const size_t block_size = hog.get_block_hist_size();
+        const size_t n_blocks = hog.n_blocks(window.size());
+        
+        HOG::Layout padded;
+        padded.padding = 16;
+        HOG::THist out;
+        hog.retrieve(window, padded, out);
+        if(out.size() != n_blocks*48 || out.size() != hog.descriptor_size(window.size(), padded)) {
+            std::cout << "Test layout (padded size) failed!\n";  exit(-1);
+        }
+        for(size_t k=0; k<n_blocks; ++k) {
+            for(size_t i=0; i<48; ++i) {
+                const float expected = i < block_size ? hist[k*block_size+i] : 0;
+                if(out[k*48+i] != expected) {
+                    std::cout << "Test layout (padded values) failed!\n";  exit(-1);
+                }
+            }
+        }
+        
+        HOG::Layout channels;
+        channels.order = HOG::Layout::ORDER::channels_first;
+        channels.padding = 8;
+        hog.retrieve(window, channels, out);
+        const size_t plane = (n_blocks*4 + 7)/8*8;
+        if(out.size() != 9*plane) {
+            std::cout << "Test layout (channels size) failed!\n";  exit(-1);
+        }
+        for(size_t k=0; k<n_blocks; ++k)
+            for(size_t c=0; c<4; ++c)
+                for(size_t b=0; b<9; ++b)
+                    if(out[b*plane + k*4 + c] != hist[k*block_size + c*9 + b]) {
+                        std::cout << "Test layout (channels values) failed!\n";  exit(-1);
+                    }
+        
+        HOG::Layout aligned;
+        aligned.alignment = 64;
+        std::vector<float> buffer(hist.size() + 32);
+        float* unaligned = reinterpret_cast<float*>((reinterpret_cast<uintptr_t>(buffer.data()) + 63)/64*64) + 1;
+        try {
+            hog.retrieve(window, aligned, unaligned);
+            std::cout << "Test layout (alignment) failed!\n";  exit(-1);
+        } catch(const std::runtime_error&) { }
+        try {
+            hog.retrieve(window, aligned, out);
+            std::cout << "Test layout (vector alignment) failed!\n";  exit(-1);
+        } catch(const std::runtime_error&) { }
+        aligned.alignment = alignof(float);
+        hog.retrieve(window, aligned, out);
+        if(out != hist) {
+            std::cout << "Test layout (vector) failed!\n";  exit(-1);
+        }
+    }
+    
+    {   // Testing the sliding windows range: every window (the last ones included)
+        // and the same HOG as HOG::retrieve(), also when the range is split
+        
+        // full image
+        cv::Mat image = cv::imread("../img/astronaut.JPG", CV_8U);
+        
+        HOG hog(16, 8, 8, 9, HOG::GRADIENT_UNSIGNED, HOG::BLOCK_NORM::L2hys);
+        hog.process(image);
+        cv::Size window(64,128);
+        const int stride = 16;
+        
+        std::vector<cv::Rect> expected;
+        for(int y=0; y<=image.rows-window.height; y += stride)
+            for(int x=0; x<=image.cols-window.width; x += stride)
+                expected.push_back(cv::Rect(x, y, window.width, window.height));
+        
+        auto range = hog.windows(window, stride);
+        if(range.size() != expected.size() || std::distance(range.begin(), range.end()) != static_cast<std::ptrdiff_t>(expected.size())) {
+            std::cout << "Test windows (size) failed!\n";  exit(-1);
+        }
+        size_t i = 0;
+        for(const auto& w : range) {
+            if(w.rect != expected[i] || (i%97 == 0 && w.descriptor != hog.retrieve(w.rect))) {
+                std::cout << "Test windows (iteration) failed!\n";  exit(-1);
+            }
+            ++i;
+        }
+        const size_t last = expected.size()-1;
+        if(range.rect(last) != expected[last] || range.at(last).rect != expected[last] || range.at(last).descriptor != hog.retrieve(expected[last])) {
+            std::cout << "Test windows (direct access) failed!\n";  exit(-1);
+        }
+        try {
+            range.rect(expected.size());
+            std::cout << "Test windows (index out of range) failed!\n";  exit(-1);
+        } catch(const std::runtime_error&) { }
+        
+        auto it = range.begin();
+        std::advance(it, 5);
+        const HOG::WindowRange::Window* value = &*it;
+        if(&*it != value || it->rect != expected[5] || it->descriptor != hog.retrieve(expected[5])) {
+            std::cout << "Test windows (reference) failed!\n";  exit(-1);
+        }
+        auto previous = it++;
+        if((*previous).rect != expected[5] || (*previous).descriptor != hog.retrieve(expected[5]) ||
+           it->rect != expected[6] || it->descriptor != hog.retrieve(expected[6]) || (*it++).rect != expected[6]) {
+            std::cout << "Test windows (increment) failed!\n";  exit(-1);
+        }
+        
+        struct split {};
+        auto first = hog.windows(window, stride).set_grain(4);
+        HOG::WindowRange second(first, split());
+        if(first.size() + second.size() != expected.size() || first.end() != second.begin() || !first.is_divisible() ||
+           second.rect(0) != expected[first.size()]) {
+            std::cout << "Test windows (split) failed!\n";  exit(-1);
+        }
+        
+        // parallel over the split ranges (TBB-like recursive splitting), each window
+        // finds its slot from its position in the image
+        std::vector<float> sums(expected.size());
+        std::function<void(HOG::WindowRange&)> split_and_run = [&](HOG::WindowRange& r) {
+            if(!r.is_divisible()) {
+                for(const auto& w : r)
+                    sums[(w.rect.y/stride)*r.n_windows_x() + w.rect.x/stride] = std::accumulate(w.descriptor.begin(), w.descriptor.end(), 0.0f);
+                return;
+            }
+            HOG::WindowRange half(r, split());
+            std::vector<HOG::WindowRange*> halves = {&r, &half};
+            Executor::default_executor()->parallel_for(0, 2, 1, [&](size_t b, size_t e) {
+                for(size_t k = b; k < e; ++k)
+                    split_and_run(*halves[k]);
+            });
+        };
+        auto parallel = hog.windows(window, stride).set_grain(16);
+        split_and_run(parallel);
+        for(size_t k=0; k<expected.size(); k += 53) {
+            auto hist = hog.retrieve(expected[k]);
+            if(sums[k] != std::accumulate(hist.begin(), hist.end(), 0.0f)) {
+                std::cout << "Test windows (parallel) failed!\n";  exit(-1);
+            }
+        }
+    }
+    
     std::cout << "\nTest passed!\n\n"; exit(0);
     
     return 0;